@@ -0,0 +1,21 @@
+# The game and its tools, which share the image loading code in src (see src/loader.pri). 
+# Building this project builds all of them; src/Memory.pro still builds just the game.
+
+TEMPLATE = subdirs
+
+game.file = src/Memory.pro
+# the projects are in the same folder, so each needs a makefile of its own:
+game.makefile = Makefile.Memory
+
+deckpacker.file = src/deckpacker.pro
+deckpacker.makefile = Makefile.deckpacker
+
+colorbench.file = src/colorbench.pro
+colorbench.makefile = Makefile.colorbench
+
+boardbench.file = src/boardbench.pro
+boardbench.makefile = Makefile.boardbench
+
+SUBDIRS = game deckpacker colorbench
+# (renders with the offscreen platform plugin of Qt 5)
+greaterThan(QT_MAJOR_VERSION, 4): SUBDIRS += boardbench
@@ -14,14 +14,25 @@ SOURCES += main.cpp\
            MemoryAI.cpp \
            newgamedialog.cpp \
            MTriple.cpp \
-           tileimagehandler.cpp
+           tileimagehandler.cpp \
+           imagefolderscanner.cpp \
+           imagecache.cpp \
+           tilefacecache.cpp \
+           tileatlas.cpp
 
 HEADERS  += memory.h \
     memoryview.h \
     tile.h \
     MemoryAI.h \
     newgamedialog.h \
-    tileimagehandler.h 
+    tileimagehandler.h \
+    imagefolderscanner.h \
+    imagecache.h \
+    spscqueue.h \
+    tilefacecache.h \
+    tileatlas.h
+
+include(loader.pri)
 
 RESOURCES = memoryrc.qrc
 
@@ -0,0 +1,338 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// boardbench: measures the cost of rendering the board. It builds a board of synthetic images in
+// a MemoryView under the offscreen platform plugin (which renders the window into a QImage), 
+// moves the mouse along a hover path and flips tiles with revealTile, one step per frame. For 
+// each phase, it reports the time the view took to paint each frame (percentiles), the number of
+// Tile::paint calls per tile and frame, and the bytes of the window image painted per frame.
+//
+// usage: boardbench [-p pairs] [-z zoom] [-s WxH] [-f flips] [-m hover path file]
+//
+// A hover path file has one mouse position per frame ("x y" in pixels of the view) per line, 
+// e.g. recorded from a real game. Without it, the mouse sweeps over all tiles row by row.
+
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include <QPainter>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainterPath>
+#include <stdio.h>
+#include <algorithm>
+#include "memoryview.h"
+#include "tile.h"
+
+#define DEFAULT_NUM_PAIRS 32
+#define DEFAULT_ZOOM 2.5
+#define DEFAULT_VIEW_SIZE "1280x800"
+#define DEFAULT_NUM_FLIPS 16
+// the benchmark simulates a display with this refresh rate:
+#define BENCH_FRAME_MS 16
+// number of mouse positions on each tile of the generated hover path:
+#define HOVER_STEPS_PER_TILE 8
+// a flip takes 400 ms, so it is finished after this many frames:
+#define FLIP_FRAMES 40
+#define LOAD_TIMEOUT_MS 120000
+
+
+// Measures the paint events of the view's viewport:
+class PaintMeter : public QObject
+{
+public:
+    PaintMeter(QGraphicsView *view) : _view(view), _painting(false), _bytes(0), _paint_calls(0) {}
+    
+    void reset() { _nsecs.clear(); _bytes = 0; _paint_calls = 0; }
+    const QVector<qint64> &frameNsecs() const { return _nsecs; }
+    qint64 bytesTouched() const { return _bytes; }
+    qint64 paintCalls() const { return _paint_calls; }
+    
+protected:
+    virtual bool eventFilter(QObject *watched, QEvent *event)
+    {
+        if (event->type() != QEvent::Paint || _painting)
+            return false;
+        // let the view paint now, to measure how long it takes:
+        _painting = true;
+        QElapsedTimer timer;
+        timer.start();
+        QCoreApplication::sendEvent(watched, event);
+        _nsecs << timer.nsecsElapsed();
+        _painting = false;
+        QVector<QRect> rects = static_cast<QPaintEvent*>(event)->region().rects();
+        for (int i = 0; i < rects.count(); i++)
+            _bytes += qint64(rects.at(i).width()) * rects.at(i).height() * 4;
+        // The view calls paint of the tiles in the painted region, except for the ones without 
+        // contents, which are drawn from the atlas with the background (see Tile::updateBatching):
+        QPainterPath painted;
+        painted.addRegion(static_cast<QPaintEvent*>(event)->region());
+        QList<QGraphicsItem*> items = _view->items(painted);
+        for (int i = 0; i < items.count(); i++) {
+            Tile *tile = qobject_cast<Tile*>(items.at(i)->toGraphicsObject());
+            if (tile && tile->isVisible() && !(tile->flags() & QGraphicsItem::ItemHasNoContents))
+                _paint_calls++;
+        }
+        return true;
+    }
+    
+private:
+    QGraphicsView *_view;
+    bool _painting;
+    QVector<qint64> _nsecs;
+    qint64 _bytes;
+    qint64 _paint_calls;
+};
+
+
+// Runs the event loop for one frame, so the view animates and paints as it would on screen:
+static void run_frame()
+{
+    QEventLoop loop;
+    QTimer::singleShot(BENCH_FRAME_MS, &loop, SLOT(quit()));
+    loop.exec();
+}
+
+static double percentile(const QVector<qint64> &sorted, const double p)
+{
+    if (sorted.isEmpty())
+        return 0;
+    int i = qMin(sorted.count() - 1, int(p * sorted.count()));
+    return sorted.at(i) / 1e6;
+}
+
+static void report(const char *phase, const int frames, PaintMeter &meter, const int num_tiles)
+{
+    QVector<qint64> nsecs = meter.frameNsecs();
+    std::sort(nsecs.begin(), nsecs.end());
+    printf("%s: %i frames, %i painted\n", phase, frames, nsecs.count());
+    printf("  paint time per frame [ms]: p50 %.2f, p90 %.2f, p99 %.2f, max %.2f\n",
+           percentile(nsecs, 0.5), percentile(nsecs, 0.9), percentile(nsecs, 0.99), 
+           percentile(nsecs, 1.0));
+    printf("  paint calls per tile and frame: %.3f\n", 
+           frames && num_tiles ? double(meter.paintCalls()) / frames / num_tiles : 0.0);
+    printf("  bytes touched per frame: %.1f kB\n", 
+           frames ? meter.bytesTouched() / 1024.0 / frames : 0.0);
+}
+
+// Writes num_images images of different colors to folder, returns their file names:
+static QStringList create_images(const QString &folder, const int num_images)
+{
+    QDir().mkpath(folder);
+    QStringList filenames;
+    for (int i = 0; i < num_images; i++) {
+        QImage image(800, 600, QImage::Format_RGB32);
+        QPainter painter(&image);
+        QLinearGradient gradient(0, 0, image.width(), image.height());
+        gradient.setColorAt(0, QColor::fromHsv(i * 360 / num_images, 200, 230));
+        gradient.setColorAt(1, QColor::fromHsv((i * 360 / num_images + 120) % 360, 255, 90));
+        painter.fillRect(image.rect(), gradient);
+        painter.setPen(Qt::white);
+        QFont font;
+        font.setPixelSize(200);
+        painter.setFont(font);
+        painter.drawText(image.rect(), Qt::AlignCenter, QString::number(i + 1));
+        painter.end();
+        QString filename = QString("%1/%2.jpg").arg(folder).arg(i, 4, 10, QChar('0'));
+        if (!image.save(filename, "JPG", 90)) {
+            printf("Error: Could not write %s\n", filename.toStdString().c_str());
+            return QStringList();
+        }
+        filenames << filename;
+    }
+    return filenames;
+}
+
+// Reads a hover path file, see above:
+static QList<QPoint> read_path(const QString &filename)
+{
+    QList<QPoint> path;
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return path;
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QStringList coords = in.readLine().split(' ', QString::SkipEmptyParts);
+        if (coords.count() == 2)
+            path << QPoint(coords.at(0).toInt(), coords.at(1).toInt());
+    }
+    return path;
+}
+
+// Sweeps over the tiles row by row, like a player looking for a card:
+static QList<QPoint> sweep_path(const QSize &view_size, const int cols, const int rows)
+{
+    QList<QPoint> path;
+    double cell_width = view_size.width() / double(cols), cell_height = view_size.height() / double(rows);
+    for (int j = 0; j < rows; j++) {
+        int steps = cols * HOVER_STEPS_PER_TILE;
+        for (int k = 0; k < steps; k++) {
+            // every other row from right to left:
+            double x = (j % 2 ? steps - k : k + 0.5) * cell_width / HOVER_STEPS_PER_TILE;
+            path << QPoint(int(x), int((j + 0.5) * cell_height));
+        }
+    }
+    return path;
+}
+
+static void move_mouse(QWidget *viewport, const QPoint &pos)
+{
+    QMouseEvent event(QEvent::MouseMove, pos, Qt::NoButton, Qt::NoButton, Qt::NoModifier);
+    QCoreApplication::sendEvent(viewport, &event);
+}
+
+static void click(QWidget *viewport, const QPoint &pos)
+{
+    QMouseEvent press(QEvent::MouseButtonPress, pos, Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    QCoreApplication::sendEvent(viewport, &press);
+    QMouseEvent release(QEvent::MouseButtonRelease, pos, Qt::LeftButton, Qt::NoButton, Qt::NoModifier);
+    QCoreApplication::sendEvent(viewport, &release);
+}
+
+// Runs frames until the board is ready, but at most FLIP_FRAMES. After the second tile has been
+// revealed, the board only gets ready with the next click. Returns the number of frames:
+static int run_until_ready(MemoryView &view)
+{
+    int frames = 0;
+    while (frames < FLIP_FRAMES && (frames == 0 || !view.is_board_ready())) {
+        run_frame();
+        frames++;
+    }
+    return frames;
+}
+
+int main(int argc, char** argv)
+{
+    // without a platform given, render into an image instead of a window:
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    // keep the settings apart from the game's:
+    QCoreApplication::setOrganizationName("Memoria");
+    QCoreApplication::setApplicationName("boardbench");
+    QStringList args = app.arguments();
+    args.removeFirst();
+    
+    int num_pairs = DEFAULT_NUM_PAIRS;
+    double zoom = DEFAULT_ZOOM;
+    QString view_size_text = DEFAULT_VIEW_SIZE;
+    int num_flips = DEFAULT_NUM_FLIPS;
+    QString path_filename;
+    bool valid = true;
+    while (!args.isEmpty()) {
+        QString option = args.takeFirst();
+        if (option == "-p" && !args.isEmpty())
+            num_pairs = args.takeFirst().toInt();
+        else if (option == "-z" && !args.isEmpty())
+            zoom = args.takeFirst().toDouble();
+        else if (option == "-s" && !args.isEmpty())
+            view_size_text = args.takeFirst();
+        else if (option == "-f" && !args.isEmpty())
+            num_flips = args.takeFirst().toInt();
+        else if (option == "-m" && !args.isEmpty())
+            path_filename = args.takeFirst();
+        else
+            valid = false;
+    }
+    QSize view_size(view_size_text.section('x', 0, 0).toInt(), view_size_text.section('x', 1, 1).toInt());
+    if (!valid || num_pairs < 1 || zoom < 1.0 || view_size.isEmpty() || num_flips < 0) {
+        printf("usage: boardbench [-p pairs] [-z zoom] [-s WxH] [-f flips] [-m hover path file]\n"
+               "  -p  number of pairs on the board (default: %i)\n"
+               "  -z  zoom factor of hovered tiles (default: %.1f)\n"
+               "  -s  size of the view (default: %s)\n"
+               "  -f  number of tiles revealed (default: %i)\n"
+               "  -m  file with one mouse position \"x y\" per line and frame\n"
+               "      (default: the mouse sweeps over all tiles)\n",
+               DEFAULT_NUM_PAIRS, DEFAULT_ZOOM, DEFAULT_VIEW_SIZE, DEFAULT_NUM_FLIPS);
+        return 1;
+    }
+    
+    QString folder = QDir::tempPath() + QString("/boardbench-%1").arg(QCoreApplication::applicationPid());
+    QStringList filenames = create_images(folder, num_pairs);
+    if (filenames.isEmpty())
+        return 1;
+    
+    MemoryView view(4, ":/backside.png", zoom);
+    view.resize(view_size);
+    view.show();
+    PaintMeter meter(&view);
+    view.viewport()->installEventFilter(&meter);
+    
+    int cols, rows;
+    view.calculate_best_distribution(cols, rows, 2 * num_pairs);
+    QElapsedTimer load_timer;
+    load_timer.start();
+    QEventLoop loading;
+    QObject::connect(&view, SIGNAL(imagesLoaded()), &loading, SLOT(quit()));
+    QTimer::singleShot(LOAD_TIMEOUT_MS, &loading, SLOT(quit()));
+    if (!view.set_images(num_pairs, cols, rows, filenames)) {
+        printf("Error: Could not set up the board.\n");
+        return 1;
+    }
+    loading.exec();
+    printf("%i pairs on %ix%i tiles, zoom %.1f, view %ix%i, images loaded in %lli ms\n", 
+           num_pairs, cols, rows, zoom, view_size.width(), view_size.height(), 
+           (long long)load_timer.elapsed());
+    // paint the whole board once before measuring:
+    run_frame();
+    
+    // hovering:
+    QList<QPoint> path = path_filename.isEmpty() ? sweep_path(view_size, cols, rows) : read_path(path_filename);
+    meter.reset();
+    for (int i = 0; i < path.count(); i++) {
+        move_mouse(view.viewport(), path.at(i));
+        run_frame();
+    }
+    report("hover", path.count(), meter, 2 * num_pairs);
+    // move the mouse off the board:
+    move_mouse(view.viewport(), QPoint(0, 0));
+    QEvent leave(QEvent::Leave);
+    QCoreApplication::sendEvent(&view, &leave);
+    run_frame();
+    
+    // flipping, the tiles one after another:
+    meter.reset();
+    int frames = 0;
+    for (int i = 0; i < num_flips; i++) {
+        int tile = i % (2 * num_pairs);
+        view.revealTile(tile % cols, tile / cols);
+        frames += run_until_ready(view);
+        if (!view.is_board_ready()) {
+            // two tiles are revealed, a click next to the board hides or removes them:
+            click(view.viewport(), QPoint(0, 0));
+            frames += run_until_ready(view);
+        }
+    }
+    report("flip", frames, meter, 2 * num_pairs);
+    
+    view.clear();
+    for (int i = 0; i < filenames.count(); i++)
+        QFile::remove(filenames.at(i));
+    QDir().rmdir(folder);
+    return 0;
+}
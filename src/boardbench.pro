@@ -0,0 +1,35 @@
+# Measures the cost of rendering the board, see boardbench.cpp
+
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+# renders with the offscreen platform plugin, which Qt 4 does not have:
+lessThan(QT_MAJOR_VERSION, 5): error("boardbench needs Qt 5")
+
+CONFIG += static console
+CONFIG -= app_bundle
+
+TARGET = boardbench
+TEMPLATE = app
+
+# the board of the game:
+SOURCES += boardbench.cpp \
+           memoryview.cpp \
+           tile.cpp \
+           tilefacecache.cpp \
+           tileatlas.cpp \
+           tileimagehandler.cpp \
+           imagecache.cpp
+
+HEADERS  += memoryview.h \
+    tile.h \
+    tilefacecache.h \
+    tileatlas.h \
+    tileimagehandler.h \
+    imagecache.h \
+    spscqueue.h
+
+include(loader.pri)
+
+# for the backside image:
+RESOURCES = memoryrc.qrc
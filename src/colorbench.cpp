@@ -0,0 +1,279 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// colorbench: compares get_most_prominent_color with the version before the flat histograms 
+// (hashing the rgb-triplets, see old_get_most_prominent_color below). Both find the border color
+// of the same synthetic images: noise, gray noise, a few clusters of colors, and posterized 
+// gradients. It reports the time per image of each version and the images on which their colors
+// differ, and fails if there are any.
+//
+// usage: colorbench [-n images] [-s max size] [-r repetitions] [-x seed]
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QHash>
+#include <QStringList>
+#include <stdio.h>
+#include <stdlib.h>
+#include "imagedecoder.h"
+
+#define DEFAULT_NUM_IMAGES 3000
+#define DEFAULT_MAX_SIZE 800
+#define DEFAULT_REPETITIONS 3
+#define DEFAULT_SEED 1
+// the number of differing colors which are printed:
+#define MAX_REPORTED_MISMATCHES 10
+
+
+// The version of get_most_prominent_color before the flat histograms, unchanged:
+
+struct pixeldata_t { int r, g, b, weight, count; };
+
+inline static int rgb2key(int r, int g, int b, int bitshift) {
+    return (((r >> bitshift) << 16) + 
+    ((g >> bitshift) <<  8) + 
+    (b >> bitshift) );
+}
+
+inline static int favorHue(int r, int g, int b) {
+    return (abs(r-g)*abs(r-g) + abs(r-b)*abs(r-b) + abs(g-b)*abs(g-b)) / 1000 + 1; 
+}
+
+static int old_find_most_prominent_equivalence_class(const QHash<int, pixeldata_t> data, const int bitshift,
+                                                     const int allowed_key=0, const int allowed_key_bitshift=8) {
+    QHash<int, int> eqclass_counts;
+    int r, g, b, key = 0, count;
+    // scan through all pixels:
+    QHash<int, pixeldata_t>::const_iterator di;
+    for (di = data.constBegin(); di != data.constEnd(); ++di) {
+        // get rgb values:
+        r = di.value().r;
+        g = di.value().g;
+        b = di.value().b;
+        // check whether pixel belongs to allowed equivalence class allowed_key 
+        // by shifting it with corresponding allowed_key_bitshift:
+        if (rgb2key(r, g, b, allowed_key_bitshift) == allowed_key) {
+            // pixel is allowed, so designate a new equivalence key:
+            key = rgb2key(r, g, b, bitshift);
+            if (key != 0) { // discard very dark color
+                // add to the count for this key:
+                count = di.value().weight * di.value().count;
+                eqclass_counts.insert(key, eqclass_counts.value(key, 0) + count);
+            }
+        }
+    }
+    
+    // iterate through equivalence class counts and return most prominent member's key:
+    QHash<int, int>::const_iterator i;
+    count = 0;
+    for (i = eqclass_counts.constBegin(); i != eqclass_counts.constEnd(); ++i) {
+        if (i.value() > count) {
+            count = i.value();
+            key = i.key();
+        }
+    }
+    return key;
+}
+
+static QColor old_get_most_prominent_color(const QImage &image, const int max_pixel = 5000) {
+    const QRgb *rgbdata;
+    QHash<int, pixeldata_t> data;
+    pixeldata_t pd;
+    int key;
+    int pixelcount = image.width() * image.height();
+    // we don't need to count all pixels, so skip some:
+    int skip = pixelcount < max_pixel ? 1 : pixelcount / max_pixel;
+
+    QRgb pixel;
+    int r, g, b;
+    bool monochrome = true;
+    rgbdata = (const QRgb*) image.constBits();
+    // count the occurences of rgb-triplets and save in data:
+    for (int i = 0; i < pixelcount; i += skip) {
+        // get rgb values:
+        pixel = rgbdata[i];
+        r = qRed(pixel);
+        g = qGreen(pixel);
+        b = qBlue(pixel);
+        key = rgb2key(r, g, b, 0);
+        if (data.contains(key)){
+            pd = data.value(key);
+            pd.count++;
+            data[key] = pd;
+        }
+        else {
+            pd.r = r;
+            pd.g = g;
+            pd.b = b;
+            pd.weight = favorHue(r, g, b);
+            pd.count = 1;
+            data.insert(key, pd);
+            if (r != g || g != b)
+                monochrome = false;
+        }
+    }
+
+    if (monochrome)
+        return QColor("black");
+
+    key = old_find_most_prominent_equivalence_class(data, 6);
+    key = old_find_most_prominent_equivalence_class(data, 4, key, 6);
+    key = old_find_most_prominent_equivalence_class(data, 2, key, 4);
+    key = old_find_most_prominent_equivalence_class(data, 0, key, 2);
+    r = key >> 16;
+    key -= (r << 16);
+    g = key >> 8;
+    key -= (g << 8);
+    b = key;
+    return QColor(r, g, b);
+}
+
+
+enum ImageKind { NOISE, GRAY, CLUSTERED, POSTERIZED, NUM_KINDS };
+static const char *kind_names[NUM_KINDS] = { "noise", "gray", "clustered", "posterized" };
+
+static int random_below(const int n)
+{
+    return n > 0 ? qrand() % n : 0;
+}
+
+// Returns a random image of the given kind in the format of the images on the tiles:
+static QImage create_image(const ImageKind kind, const int max_size)
+{
+    int width = 1 + random_below(max_size), height = 1 + random_below(max_size);
+    QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+    QRgb clusters[8];
+    int num_clusters = 2 + random_below(7);
+    for (int i = 0; i < num_clusters; i++)
+        clusters[i] = qRgb(random_below(256), random_below(256), random_below(256));
+    int levels = 2 + random_below(6);
+    for (int y = 0; y < height; y++) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < width; x++) {
+            int v;
+            QRgb c;
+            switch (kind) {
+            case NOISE:
+                line[x] = qRgb(random_below(256), random_below(256), random_below(256));
+                break;
+            case GRAY:
+                v = random_below(256);
+                line[x] = qRgb(v, v, v);
+                break;
+            case CLUSTERED:
+                // a few colors, slightly disturbed:
+                c = clusters[random_below(num_clusters)];
+                line[x] = qRgb(qBound(0, qRed(c) + random_below(9) - 4, 255), 
+                               qBound(0, qGreen(c) + random_below(9) - 4, 255), 
+                               qBound(0, qBlue(c) + random_below(9) - 4, 255));
+                break;
+            default:
+                // a diagonal gradient with few levels per component:
+                line[x] = qRgb(255 * (x * levels / width) / levels, 255 * (y * levels / height) / levels,
+                               255 * ((x + y) * levels / (width + height)) / levels);
+            }
+        }
+    }
+    return image;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeFirst();
+    
+    int num_images = DEFAULT_NUM_IMAGES;
+    int max_size = DEFAULT_MAX_SIZE;
+    int repetitions = DEFAULT_REPETITIONS;
+    uint seed = DEFAULT_SEED;
+    bool valid = true;
+    while (!args.isEmpty()) {
+        QString option = args.takeFirst();
+        if (option == "-n" && !args.isEmpty())
+            num_images = args.takeFirst().toInt();
+        else if (option == "-s" && !args.isEmpty())
+            max_size = args.takeFirst().toInt();
+        else if (option == "-r" && !args.isEmpty())
+            repetitions = args.takeFirst().toInt();
+        else if (option == "-x" && !args.isEmpty())
+            seed = args.takeFirst().toUInt();
+        else
+            valid = false;
+    }
+    if (!valid || num_images < 1 || max_size < 1 || repetitions < 1) {
+        printf("usage: colorbench [-n images] [-s max size] [-r repetitions] [-x seed]\n"
+               "  -n  number of generated images (default: %i)\n"
+               "  -s  maximum width and height of the images (default: %i)\n"
+               "  -r  number of times the color of each image is found (default: %i)\n"
+               "  -x  seed of the random images (default: %i)\n",
+               DEFAULT_NUM_IMAGES, DEFAULT_MAX_SIZE, DEFAULT_REPETITIONS, DEFAULT_SEED);
+        return 1;
+    }
+    
+    qsrand(seed);
+    qint64 old_nsecs[NUM_KINDS] = {0}, new_nsecs[NUM_KINDS] = {0};
+    int counts[NUM_KINDS] = {0}, mismatches[NUM_KINDS] = {0};
+    int total_mismatches = 0;
+    QElapsedTimer timer;
+    for (int i = 0; i < num_images; i++) {
+        ImageKind kind = ImageKind(i % NUM_KINDS);
+        QImage image = create_image(kind, max_size);
+        QColor old_color, new_color;
+        // alternating, so neither version profits from a warm cache:
+        timer.start();
+        for (int j = 0; j < repetitions; j++)
+            old_color = old_get_most_prominent_color(image);
+        old_nsecs[kind] += timer.nsecsElapsed();
+        timer.start();
+        for (int j = 0; j < repetitions; j++)
+            new_color = get_most_prominent_color(image);
+        new_nsecs[kind] += timer.nsecsElapsed();
+        counts[kind]++;
+        if (old_color != new_color) {
+            if (total_mismatches < MAX_REPORTED_MISMATCHES)
+                printf("image %i (%s, %ix%i): old color %s, new color %s\n", i, kind_names[kind], 
+                       image.width(), image.height(), old_color.name().toStdString().c_str(), 
+                       new_color.name().toStdString().c_str());
+            mismatches[kind]++;
+            total_mismatches++;
+        }
+    }
+    
+    qint64 old_total = 0, new_total = 0;
+    printf("%i images up to %ix%i, %i repetitions, seed %u\n", num_images, max_size, max_size, repetitions, seed);
+    printf("%-12s %8s %12s %12s %8s %10s\n", "kind", "images", "old [us]", "new [us]", "speedup", "different");
+    for (int k = 0; k < NUM_KINDS; k++) {
+        int calls = qMax(1, counts[k] * repetitions);
+        printf("%-12s %8i %12.1f %12.1f %7.1fx %10i\n", kind_names[k], counts[k], 
+               old_nsecs[k] / 1e3 / calls, new_nsecs[k] / 1e3 / calls, 
+               new_nsecs[k] ? double(old_nsecs[k]) / new_nsecs[k] : 0.0, mismatches[k]);
+        old_total += old_nsecs[k];
+        new_total += new_nsecs[k];
+    }
+    printf("total: old %.2f s, new %.2f s, speedup %.1fx, %i different colors\n", old_total / 1e9, 
+           new_total / 1e9, new_total ? double(old_total) / new_total : 0.0, total_mismatches);
+    return total_mismatches ? 1 : 0;
+}
@@ -0,0 +1,14 @@
+# Compares the border color finder with its previous version, see colorbench.cpp
+
+QT       += core gui
+
+CONFIG += static console
+CONFIG -= app_bundle
+
+TARGET = colorbench
+TEMPLATE = app
+
+SOURCES += colorbench.cpp
+
+# get_most_prominent_color and the decode path it is part of:
+include(loader.pri)
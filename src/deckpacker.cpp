@@ -0,0 +1,177 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// deckpacker: packs the images of a folder (or image archive) into a deck file, which the game
+// uses instead of decoding the images (see PackedDeck). The images are decoded for several tile
+// sizes by the game's own decoder (see decode_image_levels), so the pixels and border colors are
+// the same as if the game decoded them.
+//
+// usage: deckpacker [-r] [-s tilesizes] [-z max_zoom] <folder or archive> [deck file]
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QDirIterator>
+#include <QRegExp>
+#include <QBuffer>
+#include <QImageReader>
+#include <stdio.h>
+#include "packeddeck.h"
+#include "imagedecoder.h"
+
+// The defaults fit the tile sizes of usual boards and the zoom factor of the game:
+#define DEFAULT_TILE_SIZES "128,256,512"
+#define DEFAULT_MAX_ZOOM 2.5
+
+
+// Returns the names of the images in path (a folder or an image archive), relative to path:
+static QStringList find_images(const QString &path, const bool recursive)
+{
+    QStringList filenamefilter;
+    QList<QByteArray> sifs(QImageReader::supportedImageFormats());
+    for (int i = 0; i < sifs.count(); i++)
+        filenamefilter << "*." + sifs.at(i);
+    
+    QStringList names;
+    if (ImageArchive::isArchive(path)) {
+        QSharedPointer<ImageArchive> archive = ImageArchive::open(path);
+        QStringList entries = archive ? archive->entryNames() : QStringList();
+        for (int i = 0; i < entries.count(); i++) {
+            if (!recursive && entries.at(i).contains('/'))
+                continue;
+            for (int j = 0; j < filenamefilter.count(); j++)
+                if (QRegExp(filenamefilter.at(j), Qt::CaseInsensitive, QRegExp::Wildcard).exactMatch(entries.at(i).section('/', -1))) {
+                    names << entries.at(i);
+                    break;
+                }
+        }
+    } else {
+        QDir folder(path);
+        QDirIterator it(path, filenamefilter, QDir::Files | QDir::Readable,
+                        recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+        while (it.hasNext())
+            names << folder.relativeFilePath(it.next());
+    }
+    return names;
+}
+
+// Decodes filename for all tilesizes (sorted, smallest first). Returns false if it is not a 
+// readable image.
+static bool pack_image(const QString &filename, const QList<int> &tilesizes, const double max_zoom, 
+                       PackedDeck::Image &packed)
+{
+    QString path;
+    qint64 mtime;
+    if (!image_file_info(filename, path, mtime, packed.file_size))
+        return false;
+    // (the header is enough for the size)
+    QByteArray header = read_image_file(filename, EXIF_MAX_HEADER_SIZE);
+    QBuffer buffer(&header);
+    packed.original_size = QImageReader(&buffer, QFileInfo(filename).suffix().toLower().toLatin1()).size();
+    packed.max_zoom = max_zoom;
+    packed.levels.clear();
+    packed.tilesizes.clear();
+    packed.bordercolors.clear();
+    QAtomicInt not_canceled(0);
+    for (int i = 0; i < tilesizes.count(); i++) {
+        // without index, deck or cache, like the first time the game decodes it for this tile size:
+        QColor bordercolor;
+        ImagePyramid levels = decode_image_levels(filename, tilesizes.at(i), max_zoom, NULL, NULL, NULL,
+                                                  &not_canceled, bordercolor);
+        if (levels.isEmpty())
+            return false;
+        if (!packed.levels.isEmpty() && packed.levels.last().size() == levels.first().size())
+            // the image is too small for this tile size, the previous level has it in full size already:
+            packed.tilesizes.last() = tilesizes.at(i);
+        else {
+            packed.levels << levels.first();
+            packed.tilesizes << tilesizes.at(i);
+            packed.bordercolors << bordercolor;
+        }
+    }
+    if (!packed.original_size.isValid())
+        packed.original_size = packed.levels.last().size();
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeFirst();
+    
+    bool recursive = false;
+    QString sizes = DEFAULT_TILE_SIZES;
+    double max_zoom = DEFAULT_MAX_ZOOM;
+    while (!args.isEmpty() && args.first().startsWith('-')) {
+        QString option = args.takeFirst();
+        if (option == "-r")
+            recursive = true;
+        else if (option == "-s" && !args.isEmpty())
+            sizes = args.takeFirst();
+        else if (option == "-z" && !args.isEmpty())
+            max_zoom = args.takeFirst().toDouble();
+        else {
+            args.clear();
+            break;
+        }
+    }
+    QList<int> tilesizes;
+    QStringList size_list = sizes.split(',', QString::SkipEmptyParts);
+    for (int i = 0; i < size_list.count(); i++)
+        if (size_list.at(i).toInt() > 0)
+            tilesizes << size_list.at(i).toInt();
+    qSort(tilesizes);
+    if (args.isEmpty() || args.count() > 2 || tilesizes.isEmpty() || max_zoom < 1.0) {
+        printf("usage: deckpacker [-r] [-s tilesizes] [-z max_zoom] <folder or archive> [deck file]\n"
+               "  -r  include the subfolders\n"
+               "  -s  comma-separated tile sizes to pack the images for (default: %s)\n"
+               "  -z  zoom factor of hovered tiles (default: %.1f)\n"
+               "The deck file is saved next to the folder by default, where the game finds it.\n",
+               DEFAULT_TILE_SIZES, DEFAULT_MAX_ZOOM);
+        return 1;
+    }
+    QString path = QFileInfo(args.at(0)).absoluteFilePath();
+    QString deck_filename = args.count() > 1 ? args.at(1) : PackedDeck::fileName(path);
+    
+    // an image deck is opened only once for all of its entries:
+    QSharedPointer<ImageArchive> archive = ImageArchive::isArchive(path) ? ImageArchive::open(path) 
+                                                                        : QSharedPointer<ImageArchive>();
+    QStringList names = find_images(path, recursive);
+    QList<PackedDeck::Image> images;
+    for (int i = 0; i < names.count(); i++) {
+        PackedDeck::Image packed;
+        packed.name = names.at(i);
+        if (pack_image(path + '/' + names.at(i), tilesizes, max_zoom, packed)) {
+            images << packed;
+            printf("%i/%i %s\n", i + 1, names.count(), names.at(i).toStdString().c_str());
+        } else
+            printf("WARNING: Skipping %s, it can't be read.\n", names.at(i).toStdString().c_str());
+    }
+    if (!PackedDeck::write(deck_filename, images)) {
+        printf("Error: Could not write deck file %s\n", deck_filename.toStdString().c_str());
+        return 1;
+    }
+    printf("packed %i images into %s.\n", images.count(), deck_filename.toStdString().c_str());
+    return 0;
+}
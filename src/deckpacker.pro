@@ -0,0 +1,16 @@
+# Packs the images of a folder into a deck file, see deckpacker.cpp
+
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += static console
+CONFIG -= app_bundle
+
+TARGET = deckpacker
+TEMPLATE = app
+
+SOURCES += deckpacker.cpp
+
+# the image loading code of the game, so the images are packed exactly as the game decodes them:
+include(loader.pri)
@@ -0,0 +1,144 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "exif.h"
+
+// EXIF tags used here:
+#define EXIF_TAG_ORIENTATION 0x0112
+#define EXIF_TAG_THUMBNAIL_OFFSET 0x0201
+#define EXIF_TAG_THUMBNAIL_LENGTH 0x0202
+
+
+// Reads the integers of the TIFF structure inside the EXIF segment, in its byte order.
+// All reads outside of the data return 0.
+class TiffReader
+{
+public:
+    TiffReader(const uchar *data, const int size, const bool little_endian) : 
+    _data(data), _size(size), _littleEndian(little_endian) {};
+    
+    quint16 read16(const quint32 offset) const {
+        if (offset + 2 > (quint32)_size || offset + 2 < offset)
+            return 0;
+        const uchar *p = _data + offset;
+        return _littleEndian ? p[0] | (p[1] << 8) : (p[0] << 8) | p[1];
+    };
+    quint32 read32(const quint32 offset) const {
+        if (offset + 4 > (quint32)_size || offset + 4 < offset)
+            return 0;
+        const uchar *p = _data + offset;
+        return _littleEndian ? p[0] | (p[1] << 8) | (p[2] << 16) | ((quint32)p[3] << 24) :
+                               ((quint32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    };
+    
+private:
+    const uchar *_data;
+    const int _size;
+    const bool _littleEndian;
+};
+
+
+bool parse_exif(const QByteArray& data, int& orientation, QByteArray& thumbnail)
+{
+    orientation = 1;
+    thumbnail.clear();
+    const uchar *d = reinterpret_cast<const uchar*>(data.constData());
+    const int size = data.size();
+    // start of image marker:
+    if (size < 4 || d[0] != 0xff || d[1] != 0xd8)
+        return false;
+    
+    // Walk through the segments until the APP1 segment with the EXIF data is found:
+    int pos = 2;
+    while (pos + 4 <= size) {
+        if (d[pos] != 0xff)
+            // broken file
+            return false;
+        const uchar marker = d[pos + 1];
+        const int length = (d[pos + 2] << 8) | d[pos + 3]; // includes these two bytes
+        if (marker == 0xda || marker == 0xd9 || length < 2)
+            // start of the image data or end of image: no EXIF data
+            return false;
+        if (marker == 0xe1 && length >= 8 && pos + 10 <= size && memcmp(d + pos + 4, "Exif\0\0", 6) == 0) {
+            // The TIFF structure follows the EXIF header. The offsets inside are relative to its start:
+            const uchar *tiff = d + pos + 10;
+            const int tiff_size = qMin(length - 8, size - pos - 10);
+            if (tiff_size < 8 || (tiff[0] != tiff[1]) || (tiff[0] != 'I' && tiff[0] != 'M'))
+                return false;
+            TiffReader reader(tiff, tiff_size, tiff[0] == 'I');
+            
+            // IFD0 describes the image itself:
+            quint32 ifd = reader.read32(4);
+            quint16 count = reader.read16(ifd);
+            for (quint32 i = 0; i < count; ++i) {
+                quint32 entry = ifd + 2 + 12 * i;
+                if (reader.read16(entry) == EXIF_TAG_ORIENTATION)
+                    // a SHORT value, stored in the first bytes of the value field:
+                    orientation = reader.read16(entry + 8);
+            }
+            // IFD1 describes the thumbnail:
+            ifd = ifd ? reader.read32(ifd + 2 + 12 * count) : 0;
+            quint32 thumbnail_offset = 0, thumbnail_length = 0;
+            count = ifd ? reader.read16(ifd) : 0;
+            for (quint32 i = 0; i < count; ++i) {
+                quint32 entry = ifd + 2 + 12 * i;
+                quint16 tag = reader.read16(entry);
+                if (tag == EXIF_TAG_THUMBNAIL_OFFSET)
+                    thumbnail_offset = reader.read32(entry + 8);
+                else if (tag == EXIF_TAG_THUMBNAIL_LENGTH)
+                    thumbnail_length = reader.read32(entry + 8);
+            }
+            if (thumbnail_offset > 0 && thumbnail_length > 0 && 
+                thumbnail_offset + thumbnail_length <= (quint32)tiff_size &&
+                thumbnail_offset + thumbnail_length > thumbnail_offset)
+                thumbnail = QByteArray(reinterpret_cast<const char*>(tiff + thumbnail_offset), thumbnail_length);
+            return true;
+        }
+        pos += 2 + length;
+    }
+    return false;
+}
+
+QImage apply_exif_orientation(const QImage& image, const int orientation)
+{
+    // Mirroring (if any) comes first, then the rotation clockwise:
+    switch (orientation) {
+        case 2:
+            return image.mirrored(true, false);
+        case 3:
+            return image.transformed(QTransform().rotate(180));
+        case 4:
+            return image.mirrored(false, true);
+        case 5:
+            return image.mirrored(true, false).transformed(QTransform().rotate(270));
+        case 6:
+            return image.transformed(QTransform().rotate(90));
+        case 7:
+            return image.mirrored(true, false).transformed(QTransform().rotate(90));
+        case 8:
+            return image.transformed(QTransform().rotate(270));
+        default:
+            return image;
+    }
+}
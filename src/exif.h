@@ -0,0 +1,46 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EXIF_H
+#define EXIF_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QTransform>
+#include <string.h> // for memcmp
+
+// The EXIF data is in the first segments of a JPEG file, which are never bigger than this:
+#define EXIF_MAX_HEADER_SIZE (128 * 1024)
+
+// Parses the EXIF data of the JPEG file starting with data. Returns false if data is not a JPEG
+// file with EXIF data. Otherwise, orientation is set to the value of the orientation tag (1 if 
+// not given, see apply_exif_orientation) and thumbnail to the embedded preview image, a small 
+// JPEG file (empty if there is none).
+bool parse_exif(const QByteArray &data, int &orientation, QByteArray &thumbnail);
+
+// Returns image turned upright according to the EXIF orientation (1: upright, 2 - 8: mirrored
+// and/or rotated by multiples of 90 degrees). Other values return image unchanged.
+QImage apply_exif_orientation(const QImage &image, const int orientation);
+
+#endif // EXIF_H
@@ -0,0 +1,320 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "imagearchive.h"
+#include <zlib.h>
+
+// Entries are inflated in chunks of this size, so canceling is noticed soon:
+#define ARCHIVE_INFLATE_CHUNK_SIZE (256 * 1024)
+
+QHash<QString, QWeakPointer<ImageArchive> > ImageArchive::_archives;
+QMutex ImageArchive::_archivesMutex;
+
+
+// Read little-endian integers of the ZIP format:
+static quint16 read16(const uchar *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static quint32 read32(const uchar *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((quint32)p[3] << 24);
+}
+
+// Reads an octal number of a TAR header, terminated by a space or NUL:
+static qint64 read_octal(const uchar *p, const int length)
+{
+    qint64 value = 0;
+    for (int i = 0; i < length && p[i] >= '0' && p[i] <= '7'; ++i)
+        value = value * 8 + (p[i] - '0');
+    return value;
+}
+
+
+bool ImageArchive::isArchive(const QString& path)
+{
+    QFileInfo info(path);
+    QString suffix = info.suffix().toLower();
+    return (suffix == "zip" || suffix == "tar") && info.isFile();
+}
+
+QSharedPointer<ImageArchive> ImageArchive::open(const QString& path)
+{
+    QFileInfo info(path);
+    QString canonical_path = info.canonicalFilePath();
+    if (canonical_path.isEmpty())
+        return QSharedPointer<ImageArchive>();
+    QMutexLocker locker(&_archivesMutex);
+    QSharedPointer<ImageArchive> archive = _archives.value(canonical_path).toStrongRef();
+    if (archive && archive->_lastModified == info.lastModified().toMSecsSinceEpoch() && 
+        archive->_size == info.size())
+        return archive;
+    // (an archive which has changed stays mapped for the ones still holding it)
+    
+    // forget the archives nobody uses anymore:
+    QMutableHashIterator<QString, QWeakPointer<ImageArchive> > it(_archives);
+    while (it.hasNext())
+        if (it.next().value().isNull())
+            it.remove();
+    
+    archive = QSharedPointer<ImageArchive>(new ImageArchive(canonical_path));
+    bool valid = false;
+    if (archive->_data)
+        valid = QFileInfo(path).suffix().toLower() == "zip" ? archive->readZipIndex() : archive->readTarIndex();
+    if (!valid) {
+        printf("WARNING: Could not read image archive %s\n", path.toStdString().c_str());
+        _archives.remove(canonical_path);
+        return QSharedPointer<ImageArchive>();
+    }
+    _archives.insert(canonical_path, archive.toWeakRef());
+    return archive;
+}
+
+bool ImageArchive::findEntry(const QString& filename, QSharedPointer<ImageArchive>& archive, QString& entry)
+{
+    QString path = filename;
+    if (path.startsWith("img:")) {
+        // resolve the search path like QFile does, but it's an archive instead of a folder:
+        QStringList search_paths = QDir::searchPaths("img");
+        if (search_paths.isEmpty())
+            return false;
+        path = search_paths.first() + '/' + path.mid(4);
+    }
+    // The archive is the part up to the first ".zip/" or ".tar/" naming a file:
+    int pos = 0;
+    forever {
+        int zip = path.indexOf(".zip/", pos, Qt::CaseInsensitive);
+        int tar = path.indexOf(".tar/", pos, Qt::CaseInsensitive);
+        if (zip < 0 && tar < 0)
+            return false;
+        pos = (zip < 0 || (tar >= 0 && tar < zip) ? tar : zip) + 4;
+        if (isArchive(path.left(pos)))
+            break;
+        pos++;
+    }
+    archive = open(path.left(pos));
+    entry = path.mid(pos + 1);
+    return archive && archive->contains(entry);
+}
+
+ImageArchive::ImageArchive(const QString& path) : _path(path), _file(path), _data(NULL), _size(0)
+{
+    _lastModified = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+    if (_file.open(QIODevice::ReadOnly) && _file.size() > 0) {
+        _size = _file.size();
+        _data = _file.map(0, _size);
+    }
+}
+
+ImageArchive::~ImageArchive()
+{
+    if (_data)
+        _file.unmap(const_cast<uchar*>(_data));
+}
+
+bool ImageArchive::readZipIndex()
+{
+    // The end of central directory record is at the end of the file, followed only 
+    // by a comment of up to 64 kB:
+    const uchar *end = NULL;
+    for (qint64 pos = _size - 22; pos >= 0 && pos >= _size - 22 - 65535; --pos)
+        if (read32(_data + pos) == 0x06054b50) {
+            end = _data + pos;
+            break;
+        }
+    if (!end)
+        return false;
+    quint16 count = read16(end + 10);
+    qint64 dir_offset = read32(end + 16);
+    
+    const uchar *p = _data + dir_offset;
+    for (int i = 0; i < count; ++i) {
+        // central directory file header:
+        if (p + 46 > end || read32(p) != 0x02014b50)
+            return false;
+        quint16 flags = read16(p + 8);
+        Entry e;
+        e.method = read16(p + 10);
+        e.size = read32(p + 20);
+        e.uncompressed_size = read32(p + 24);
+        quint16 name_length = read16(p + 28);
+        quint16 extra_length = read16(p + 30);
+        quint16 comment_length = read16(p + 32);
+        qint64 header_offset = read32(p + 42);
+        if (p + 46 + name_length > end)
+            return false;
+        // bit 11: the name is UTF-8, otherwise code page 437 (close enough to Latin-1 for file names):
+        QByteArray raw_name(reinterpret_cast<const char*>(p + 46), name_length);
+        QString name = (flags & 0x800) ? QString::fromUtf8(raw_name) : QString::fromLatin1(raw_name);
+        p += 46 + name_length + extra_length + comment_length;
+        
+        if (name.endsWith('/') || (flags & 0x1) || (e.method != 0 && e.method != 8))
+            // folder, encrypted or compressed with an unsupported method
+            continue;
+        // the data follows the local file header, whose name and extra field may differ in length:
+        if (header_offset + 30 > _size || read32(_data + header_offset) != 0x04034b50)
+            continue;
+        e.offset = header_offset + 30 + read16(_data + header_offset + 26) + read16(_data + header_offset + 28);
+        if (e.offset + e.size > _size)
+            continue;
+        _entries.insert(name, e);
+        _names << name;
+    }
+    return true;
+}
+
+bool ImageArchive::readTarIndex()
+{
+    QString long_name;
+    qint64 pos = 0;
+    while (pos + 512 <= _size) {
+        const uchar *header = _data + pos;
+        if (header[0] == 0)
+            // end of archive
+            break;
+        qint64 size = read_octal(header + 124, 12);
+        char type = header[156];
+        qint64 data_offset = pos + 512;
+        // the data is padded to full blocks:
+        pos = data_offset + (size + 511) / 512 * 512;
+        if (data_offset + size > _size)
+            return false;
+        
+        if (type == 'L') {
+            // GNU extension: the name of the next entry, if it is longer than 100 characters
+            long_name = QString::fromUtf8(reinterpret_cast<const char*>(_data + data_offset), 
+                                          qstrnlen(reinterpret_cast<const char*>(_data + data_offset), size));
+            continue;
+        }
+        QString name = long_name;
+        long_name.clear();
+        if (name.isEmpty()) {
+            name = QString::fromUtf8(reinterpret_cast<const char*>(header), qstrnlen(reinterpret_cast<const char*>(header), 100));
+            // ustar: the name may be split into a prefix and the name
+            if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != 0)
+                name = QString::fromUtf8(reinterpret_cast<const char*>(header + 345), 
+                                         qstrnlen(reinterpret_cast<const char*>(header + 345), 155)) + '/' + name;
+        }
+        if (type != '0' && type != 0)
+            // folders, links, ...
+            continue;
+        if (name.startsWith("./"))
+            name = name.mid(2);
+        Entry e;
+        e.offset = data_offset;
+        e.size = e.uncompressed_size = size;
+        e.method = 0;
+        _entries.insert(name, e);
+        _names << name;
+    }
+    return true;
+}
+
+qint64 ImageArchive::entrySize(const QString& entry) const
+{
+    QHash<QString, Entry>::const_iterator it = _entries.find(entry);
+    return it == _entries.end() ? -1 : it->uncompressed_size;
+}
+
+QByteArray ImageArchive::read(const QString& entry, const QAtomicInt* canceled, const qint64 max_bytes, 
+                              qint64 *compressed_bytes) const
+{
+    if (compressed_bytes)
+        *compressed_bytes = 0;
+    QHash<QString, Entry>::const_iterator it = _entries.find(entry);
+    if (it == _entries.end())
+        return QByteArray();
+    qint64 length = max_bytes >= 0 ? qMin(max_bytes, it->uncompressed_size) : it->uncompressed_size;
+    const char *data = reinterpret_cast<const char*>(_data + it->offset);
+    
+    if (it->method == 0) {
+        if (compressed_bytes)
+            *compressed_bytes = length;
+        // no copy, the archive stays mapped:
+        return QByteArray::fromRawData(data, (int)length);
+    }
+    
+    // deflated, without zlib header:
+    QByteArray result((int)length, Qt::Uninitialized);
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+        return QByteArray();
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = it->size;
+    stream.next_out = reinterpret_cast<Bytef*>(result.data());
+    int status = Z_OK;
+    while (status == Z_OK && stream.total_out < (uLong)length) {
+        if (canceled && canceled->loadAcquire()) {
+            status = Z_DATA_ERROR;
+            break;
+        }
+        stream.avail_out = qMin((qint64)ARCHIVE_INFLATE_CHUNK_SIZE, length - (qint64)stream.total_out);
+        status = inflate(&stream, Z_NO_FLUSH);
+    }
+    if (compressed_bytes)
+        *compressed_bytes = stream.total_in;
+    bool complete = stream.total_out == (uLong)length;
+    inflateEnd(&stream);
+    if (!complete || (status != Z_OK && status != Z_STREAM_END))
+        // broken or canceled
+        return QByteArray();
+    return result;
+}
+
+
+bool image_file_info(const QString& filename, QString& canonical_path, qint64& mtime, qint64& size)
+{
+    QSharedPointer<ImageArchive> archive;
+    QString entry;
+    if (ImageArchive::findEntry(filename, archive, entry)) {
+        canonical_path = archive->path() + '/' + entry;
+        mtime = archive->lastModified();
+        size = archive->entrySize(entry);
+        return true;
+    }
+    QFileInfo info(filename);
+    if (!info.exists())
+        return false;
+    canonical_path = info.canonicalFilePath();
+    mtime = info.lastModified().toMSecsSinceEpoch();
+    size = info.size();
+    return true;
+}
+
+QByteArray read_image_file(const QString& filename, const qint64 max_bytes)
+{
+    QSharedPointer<ImageArchive> archive;
+    QString entry;
+    if (ImageArchive::findEntry(filename, archive, entry)) {
+        QByteArray data = archive->read(entry, NULL, max_bytes);
+        // a stored entry references the mapped archive, which might be unmapped once archive is released:
+        return QByteArray(data.constData(), data.size());
+    }
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return max_bytes >= 0 ? file.read(max_bytes) : file.readAll();
+}
@@ -0,0 +1,110 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMAGEARCHIVE_H
+#define IMAGEARCHIVE_H
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QHash>
+#include <QStringList>
+#include <QSharedPointer>
+#include <QMutex>
+#include <QAtomicInt>
+#include <stdio.h> // for printf()
+#include <string.h> // for memcpy()
+
+// An image deck in a single ZIP or TAR file, whose entries are read like files without 
+// extracting them. The archive is memory-mapped: entries stored uncompressed are returned 
+// without copying, deflated ones are inflated (with zlib) straight from the mapped file.
+// Only the index (the central directory of a ZIP file, the headers of a TAR file) is read 
+// when the archive is opened. All public methods are thread-safe.
+//
+// An entry is named like a file inside a folder: "<path of archive>/<name of entry>". If an 
+// archive is set as search path "img" (see Memory::setImagePath), "img:<name of entry>" works, too.
+class ImageArchive
+{
+public:
+    // Returns true if path is an existing file with the suffix of a supported archive:
+    static bool isArchive(const QString &path);
+    // Returns the opened archive path, or NULL if it can't be read. An archive is opened only once
+    // and shared by all threads as long as anyone holds it, so whoever uses an archive for a while
+    // should keep it (e.g. Memory for the current image deck). It is unmapped when the last one 
+    // releases it. If the file has changed (modification time or size), it is opened again.
+    static QSharedPointer<ImageArchive> open(const QString &path);
+    // If filename names an archive entry, sets archive and entry and returns true:
+    static bool findEntry(const QString &filename, QSharedPointer<ImageArchive> &archive, QString &entry);
+    
+    ~ImageArchive();
+    
+    QString path() const { return _path; };
+    qint64 lastModified() const { return _lastModified; };
+    // The names of all entries (without the folders), in the order they are stored:
+    QStringList entryNames() const { return _names; };
+    bool contains(const QString &entry) const { return _entries.contains(entry); };
+    // Uncompressed size of entry, -1 if there is no such entry:
+    qint64 entrySize(const QString &entry) const;
+    
+    // Returns the first max_bytes (-1: all) bytes of entry, or an empty array if it can't be read
+    // or *canceled has been set (checked while inflating). Stored entries reference the mapped file,
+    // so the archive must be kept while the returned array is used.
+    // If compressed_bytes is given, it is set to the number of bytes read from the archive.
+    QByteArray read(const QString &entry, const QAtomicInt *canceled = NULL, const qint64 max_bytes = -1,
+                    qint64 *compressed_bytes = NULL) const;
+    
+private:
+    ImageArchive(const QString &path);
+    // Read the index of the mapped file. Return false if it is not a valid archive:
+    bool readZipIndex();
+    bool readTarIndex();
+    
+    struct Entry {
+        qint64 offset; // of the data in the archive
+        qint64 size; // of the data in the archive
+        qint64 uncompressed_size;
+        int method; // 0: stored, 8: deflated
+    };
+    
+    const QString _path;
+    QFile _file;
+    const uchar *_data;
+    qint64 _size;
+    qint64 _lastModified;
+    QHash<QString, Entry> _entries;
+    QStringList _names;
+    
+    // the archives in use, by canonical path:
+    static QHash<QString, QWeakPointer<ImageArchive> > _archives;
+    static QMutex _archivesMutex;
+};
+
+// Sets the canonical path, the modification time (of the archive, for entries) and the size of 
+// filename, which can be a file or an archive entry. Returns false if it does not exist.
+bool image_file_info(const QString &filename, QString &canonical_path, qint64 &mtime, qint64 &size);
+
+// Returns the first max_bytes (-1: all) of filename, which can be a file or an archive entry:
+QByteArray read_image_file(const QString &filename, const qint64 max_bytes = -1);
+
+#endif // IMAGEARCHIVE_H
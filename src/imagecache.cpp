@@ -0,0 +1,121 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "imagecache.h"
+
+
+ImageCache::ImageCache(const qint64 max_bytes) : _hits(0), _misses(0)
+{
+    setMaxBytes(max_bytes);
+}
+
+void ImageCache::setMaxBytes(const qint64 max_bytes)
+{
+    QMutexLocker locker(&_mutex);
+    // evicts entries if necessary:
+    _entries.setMaxCost(qMin(max_bytes / 1024, (qint64)INT_MAX));
+}
+
+qint64 ImageCache::maxBytes() const
+{
+    QMutexLocker locker(&_mutex);
+    return (qint64)_entries.maxCost() * 1024;
+}
+
+QString ImageCache::key(const QString& filename)
+{
+    QString path;
+    qint64 mtime, size;
+    // (the file might be an entry of an image archive)
+    if (!image_file_info(filename, path, mtime, size))
+        return QString();
+    return path + '\n' + QString::number(mtime) + '\n' + QString::number(size);
+}
+
+bool ImageCache::find(const QString& filename, const int tilesize, const double max_zoom, 
+                      ImagePyramid& levels, QColor& bordercolor)
+{
+    QString k = key(filename);
+    QMutexLocker locker(&_mutex);
+    // (the lookup also marks the entry as recently used)
+    Entry *entry = k.isEmpty() ? NULL : _entries.object(k);
+    if (!entry || entry->tilesize < tilesize || entry->max_zoom < max_zoom) {
+        _misses++;
+        return false;
+    }
+    _hits++;
+    levels = entry->levels;
+    bordercolor = entry->bordercolor;
+    return true;
+}
+
+bool ImageCache::contains(const QString& filename, const int tilesize, const double max_zoom) const
+{
+    QString k = key(filename);
+    QMutexLocker locker(&_mutex);
+    // (this marks the entry as recently used, too, which is fine, because it is needed soon)
+    const Entry *entry = k.isEmpty() ? NULL : _entries.object(k);
+    return entry && entry->tilesize >= tilesize && entry->max_zoom >= max_zoom;
+}
+
+void ImageCache::insert(const QString& filename, const int tilesize, const double max_zoom, 
+                        const ImagePyramid& levels, const QColor& bordercolor)
+{
+    QString k = key(filename);
+    if (k.isEmpty())
+        return;
+    qint64 bytes = 0;
+    for (int i = 0; i < levels.size(); ++i)
+        bytes += (qint64)levels[i].bytesPerLine() * levels[i].height();
+    
+    QMutexLocker locker(&_mutex);
+    if (_entries.maxCost() <= 0)
+        return;
+    Entry *entry = new Entry;
+    entry->levels = levels;
+    entry->bordercolor = bordercolor;
+    entry->tilesize = tilesize;
+    entry->max_zoom = max_zoom;
+    // replaces an older entry (e.g. for smaller tiles). An entry bigger than the 
+    // whole cache is deleted right away:
+    _entries.insert(k, entry, qMax(qint64(1), bytes / 1024));
+}
+
+qint64 ImageCache::sizeInBytes() const
+{
+    QMutexLocker locker(&_mutex);
+    return (qint64)_entries.totalCost() * 1024;
+}
+
+uint ImageCache::hitCount() const
+{
+    QMutexLocker locker(&_mutex);
+    return _hits;
+}
+
+uint ImageCache::missCount() const
+{
+    QMutexLocker locker(&_mutex);
+    return _misses;
+}
@@ -0,0 +1,88 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <QCache>
+#include <QMutex>
+#include <QFileInfo>
+#include <QDateTime>
+#include <limits.h> // for INT_MAX
+#include "imagepyramid.h"
+#include "imagearchive.h"
+
+// A cache of decoded tile images in memory, which is kept from one game to the next, so images 
+// repeating in the next game don't need to be decoded or loaded from the ThumbnailCache again.
+// An entry is identified by the image's absolute path, modification time and file size. The
+// images are implicitly shared: an entry evicted while its tiles still exist only frees the
+// memory after the tiles have been deleted. If the entries need more than the size limit, the 
+// least recently used ones are evicted. All public methods are thread-safe.
+class ImageCache
+{
+public:
+    // max_bytes is the size limit of all entries together (0: the cache is disabled).
+    ImageCache(const qint64 max_bytes = 0);
+    
+    void setMaxBytes(const qint64 max_bytes);
+    qint64 maxBytes() const;
+    
+    // Returns true and sets levels and bordercolor if filename has been stored for tiles of at 
+    // least size tilesize and max_zoom.
+    bool find(const QString &filename, const int tilesize, const double max_zoom, 
+              ImagePyramid &levels, QColor &bordercolor);
+    // Like find, but without getting the entry and counting a hit or miss:
+    bool contains(const QString &filename, const int tilesize, const double max_zoom) const;
+    // Saves levels, which were decoded from filename for tiles of size tilesize and max_zoom, 
+    // together with their bordercolor:
+    void insert(const QString &filename, const int tilesize, const double max_zoom, 
+                const ImagePyramid &levels, const QColor &bordercolor);
+    
+    qint64 sizeInBytes() const;
+    // Number of calls of find which returned true or false:
+    uint hitCount() const;
+    uint missCount() const;
+    
+private:
+    struct Entry {
+        ImagePyramid levels;
+        QColor bordercolor;
+        int tilesize;
+        double max_zoom;
+    };
+    
+    // Returns the cache key of filename, or an empty string if the file does not exist:
+    static QString key(const QString &filename);
+    
+    // The cost of an entry is its size in kB (QCache counts the cost in int):
+    QCache<QString, Entry> _entries;
+    uint _hits, _misses;
+    mutable QMutex _mutex;
+    
+    // no copying
+    ImageCache(const ImageCache&);
+    ImageCache& operator=(const ImageCache&);
+};
+
+#endif // IMAGECACHE_H
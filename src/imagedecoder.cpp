@@ -0,0 +1,327 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "imagedecoder.h"
+
+
+inline static int rgb2key(int r, int g, int b, int bitshift) {
+    //return 1;
+    return (((r >> bitshift) << 16) + 
+    ((g >> bitshift) <<  8) + 
+    (b >> bitshift) );
+}
+
+inline static int favorHue(int r, int g, int b) {
+    return (abs(r-g)*abs(r-g) + abs(r-b)*abs(r-b) + abs(g-b)*abs(g-b)) / 1000 + 1; 
+}
+
+// Algorithm from Pieroxy <pieroxy@pieroxy.net>,
+// more details here: http://pieroxy.net/blog/pages/color-finder/index.html 
+// keys are the sampled pixels as 0x00rrggbb, weights their weight factors (both of length count).
+// Only pixels which belong to the equivalence class allowed_key at allowed_key_bitshift are counted,
+// and since every step shifts by 2 bits less, each of them falls into one of 4*4*4 finer classes.
+// Their weighted counts are summed up in a flat histogram, without any branches or lookups,
+// so the compiler can vectorize most of the loop.
+static int find_most_prominent_equivalence_class(const int *keys, const int *weights, const int count, 
+                                                 const int bitshift, const int allowed_key = 0, 
+                                                 const int allowed_key_bitshift = 8) {
+    int histogram[64] = {0};
+    const int channel_mask = 0xff >> allowed_key_bitshift;
+    const int allowed_mask = (channel_mask << 16) | (channel_mask << 8) | channel_mask;
+    for (int i = 0; i < count; ++i) {
+        const int key = keys[i];
+        // check whether pixel belongs to allowed equivalence class allowed_key:
+        const int allowed = ((key >> allowed_key_bitshift) & allowed_mask) == allowed_key;
+        // the next two bits of each component (below allowed_key_bitshift) designate the finer class:
+        const int bin = (((key >> (16 + bitshift)) & 3) << 4) | 
+                        (((key >> (8 + bitshift)) & 3) << 2) | 
+                        ((key >> bitshift) & 3);
+        histogram[bin] += weights[i] & -allowed;
+    }
+    if (allowed_key == 0)
+        // this bin has key 0, i.e. discard very dark color:
+        histogram[0] = 0;
+    
+    // return the key of the most prominent class. On equal counts, the one with the lowest key wins:
+    int best_bin = -1, best_count = 0;
+    for (int bin = 0; bin < 64; ++bin) 
+        if (histogram[bin] > best_count) {
+            best_count = histogram[bin];
+            best_bin = bin;
+        }
+    if (best_bin < 0)
+        return 0;
+    return ((((allowed_key >> 16) & 0xff) << 2 | (best_bin >> 4)) << 16) + 
+           ((((allowed_key >> 8) & 0xff) << 2 | ((best_bin >> 2) & 3)) << 8) + 
+           (((allowed_key & 0xff) << 2) | (best_bin & 3));
+}
+
+// Algorithm from Pieroxy <pieroxy@pieroxy.net>,
+// more details here: http://pieroxy.net/blog/pages/color-finder/index.html                
+QColor get_most_prominent_color(const QImage &image, const int max_pixel, const QAtomicInt *canceled) {
+    if (!image.isNull() && image.depth() != 32)
+        // the pixels are read directly below:
+        return get_most_prominent_color(normalize_image_format(image), max_pixel, canceled);
+    int key;
+    int pixelcount = image.width() * image.height();
+    // we don't need to count all pixels, so skip some:
+    int skip = pixelcount < max_pixel ? 1 : pixelcount / max_pixel;
+    int num_samples = pixelcount > 0 ? (pixelcount - 1) / skip + 1 : 0;
+    
+    // Copy the sampled pixels to flat arrays, which are scanned once per refinement step below.
+    // (Summing up the weights per pixel gives exactly the same result as counting each
+    // rgb-triplet first and multiplying its count with the weight.)
+    QVector<int> buffer(2 * num_samples);
+    int *keys = buffer.data(), *weights = keys + num_samples;
+    int r, g, b;
+    bool monochrome = true;
+    const QRgb *rgbdata = (const QRgb*) image.constBits();
+    for (int i = 0, j = 0; i < pixelcount; i += skip, ++j) {
+        if ((j & 1023) == 0 && canceled && canceled->loadAcquire())
+            return QColor();
+        const QRgb pixel = rgbdata[i];
+        r = qRed(pixel);
+        g = qGreen(pixel);
+        b = qBlue(pixel);
+        keys[j] = rgb2key(r, g, b, 0);
+        // The count of this color will later be multiplied by this weight factor,
+        // which gives us the possibility to tweak the final winning color:
+        weights[j] = favorHue(r, g, b);
+        monochrome = monochrome && r == g && g == b;
+    }
+
+    if (monochrome)
+        return QColor("black");
+
+    // Divide data in equivalence classes (rightshift the r, g, b values by 6, i.e. integer divide by 64,
+    // which results in values between 0 and 3 for each component. Colors are in one equivalence class
+    // if they have the same right-shifted components.) The equivalence class with the most members wins.
+    // When counting the members, their number of occurence is multiplied by their weight factor from above.
+    // The returned key denotes this equivalence class:
+    key = find_most_prominent_equivalence_class(keys, weights, num_samples, 6);
+    if (canceled && canceled->loadAcquire())
+        return QColor();
+    // Now, only count the colors in the equivalence class which was most promiment before,
+    // but this time rightshift by 4, then by 2 and finally count the colors without shifting:
+    key = find_most_prominent_equivalence_class(keys, weights, num_samples, 4, key, 6);
+    key = find_most_prominent_equivalence_class(keys, weights, num_samples, 2, key, 4);
+    key = find_most_prominent_equivalence_class(keys, weights, num_samples, 0, key, 2);
+    // key identifies the most prominent color. Transform to rgb-triplet:
+    r = key >> 16;
+    key -= (r << 16);
+    g = key >> 8;
+    key -= (g << 8);
+    b = key;
+    //printf("result: %i, %i, %i\n", r, g, b);
+    return QColor(r, g, b);
+}
+
+
+
+QImage normalize_image_format(const QImage &image)
+{
+    if (image.isNull() || image.format() == QImage::Format_ARGB32_Premultiplied)
+        // no copy
+        return image;
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+
+QSize calc_decode_size(const QSize &original_size, const int tilesize, const double max_zoom)
+{
+    // (this does not depend on the orientation, so the size before turning the image upright is fine)
+    if (!original_size.isValid() || tilesize <= 0)
+        return original_size;
+    double w = original_size.width(), h = original_size.height();
+    double factor = fmax(tilesize / fmin(w, h), tilesize * max_zoom / fmax(w, h));
+    if (factor >= 1.0)
+        return original_size;
+    return QSize(ceil(w * factor), ceil(h * factor));
+}
+
+
+CancelableFile::CancelableFile(const QString& name, const QAtomicInt* canceled) : 
+QFile(name), _canceled(canceled), _bytesRead(0), _readNsecs(0)
+{
+}
+
+CancelableBuffer::CancelableBuffer(const QByteArray& data, const QAtomicInt* canceled) :
+_data(data), _canceled(canceled)
+{
+    setBuffer(&_data);
+}
+
+qint64 CancelableBuffer::readData(char* data, qint64 maxlen)
+{
+    if (_canceled->loadAcquire())
+        return -1;
+    return QBuffer::readData(data, maxlen);
+}
+
+qint64 CancelableFile::readData(char* data, qint64 maxlen)
+{
+    if (_canceled->loadAcquire())
+        // the decoder treats this like a broken file and stops
+        return -1;
+    QElapsedTimer clock;
+    clock.start();
+    qint64 bytes = QFile::readData(data, maxlen);
+    _readNsecs += clock.nsecsElapsed();
+    if (bytes > 0)
+        _bytesRead += bytes;
+    return bytes;
+}
+
+
+ImagePyramid decode_image_levels(const QString& filename, const int tilesize, const double max_zoom, 
+                                 const ImageIndex *image_index, const PackedDeck *deck, ThumbnailCache *cache, 
+                                 const QAtomicInt *canceled, QColor& bordercolor,
+                                 QObject *handler, const uint index,
+                                 LoaderStatistics *statistics)
+{
+    StageClock clock(statistics);
+    LoaderStatistics::Source source = LoaderStatistics::SOURCE_DECK;
+    qint64 bytes_read = 0, decoded_pixels = 0;
+    QImage image;
+    // If the image is in the index, its size and border color are known without looking at it:
+    ImageInfo info;
+    bool indexed = image_index && image_index->lookup(filename, info) && info.valid;
+    if (deck && !canceled->loadAcquire())
+        // packed in advance, like the cached version below:
+        image = deck->find(filename, tilesize, max_zoom, bordercolor);
+    if (image.isNull() && cache && !canceled->loadAcquire()) {
+        // the cached version is already scaled and its border color known:
+        image = cache->find(filename, tilesize, max_zoom, bordercolor);
+        source = LoaderStatistics::SOURCE_THUMBNAIL_CACHE;
+    }
+    clock.lap(LoaderStatistics::STAGE_LOOKUP);
+    if (image.isNull() && !canceled->loadAcquire()) {
+        // The file fails as soon as loading is canceled, so the decoder stops even in the middle of
+        // a big image. Entries of an image archive are inflated before, straight from the mapped 
+        // archive (stored entries are not even copied):
+        QSharedPointer<ImageArchive> archive;
+        QString entry;
+        QByteArray entry_data;
+        CancelableFile *file = NULL;
+        QScopedPointer<QIODevice> device;
+        if (ImageArchive::findEntry(filename, archive, entry)) {
+            entry_data = archive->read(entry, canceled, -1, &bytes_read);
+            clock.lap(LoaderStatistics::STAGE_READ);
+            device.reset(new CancelableBuffer(entry_data, canceled));
+        } else {
+            file = new CancelableFile(filename, canceled);
+            device.reset(file);
+        }
+        device->open(QIODevice::ReadOnly);
+        // The suffix tells the format, as QImageReader would do it for a file name:
+        QImageReader reader(device.data(), QFileInfo(filename).suffix().toLower().toLatin1());
+        // Let the decoder do the down-scaling (e.g. the JPEG decoder skips most of the work
+        // for smaller sizes). If the format does not support this, QImageReader scales afterwards.
+        QSize original_size = indexed ? info.size : reader.size();
+        QSize size = calc_decode_size(original_size, tilesize, max_zoom);
+        if (size != original_size)
+            reader.setScaledSize(size);
+        
+        // The EXIF data of camera images tells how to turn them upright. It is at the start of the
+        // file, which is read anyway (peek leaves it to the decoder):
+        int orientation = 1;
+        QByteArray exif_thumbnail;
+        bool exif = parse_exif(device->peek(EXIF_MAX_HEADER_SIZE), orientation, exif_thumbnail);
+#if QT_VERSION >= 0x050500
+        // the orientation is applied below, like for the placeholder:
+        reader.setAutoTransform(false);
+#endif
+        // reading the header is part of decoding, the placeholder is counted separately:
+        qint64 header_nsecs = clock.split();
+        if (handler) {
+            // Until the image is decoded, the tiles show the thumbnail embedded in the EXIF data. 
+            // It has about 160 pixels and is decoded in no time:
+            QImage placeholder;
+            if (!exif_thumbnail.isEmpty())
+                placeholder = QImage::fromData(exif_thumbnail, "JPEG");
+            if (placeholder.isNull() && exif && size == original_size && 
+                original_size.width() * original_size.height() > 2000000) {
+                // A big JPEG without thumbnail, decoded in full size: decoding it in 1/8 of the
+                // size skips the expensive part and is a lot faster than the full decode.
+                QScopedPointer<QIODevice> preview_device(file ? (QIODevice*)new CancelableFile(filename, canceled) :
+                                                                new CancelableBuffer(entry_data, canceled));
+                preview_device->open(QIODevice::ReadOnly);
+                QImageReader preview_reader(preview_device.data(), "jpeg");
+#if QT_VERSION >= 0x050500
+                preview_reader.setAutoTransform(false);
+#endif
+                preview_reader.setScaledSize(original_size / 8);
+                placeholder = preview_reader.read();
+            }
+            if (!placeholder.isNull() && !canceled->loadAcquire()) {
+                placeholder = normalize_image_format(apply_exif_orientation(placeholder, orientation));
+                QColor placeholder_color = indexed ? info.bordercolor : get_most_prominent_color(placeholder, 5000, canceled);
+                QMetaObject::invokeMethod(handler, "placeholderDecoded", Qt::QueuedConnection,
+                                          Q_ARG(uint, index), Q_ARG(ImagePyramid, ImagePyramid() << placeholder), 
+                                          Q_ARG(QColor, placeholder_color));
+            }
+            clock.lap(LoaderStatistics::STAGE_PLACEHOLDER);
+        }
+        
+        // this takes some time:
+        image = reader.read();
+        // the header and the image, without reading the file:
+        if (file) {
+            clock.lap(LoaderStatistics::STAGE_DECODE, file->readNsecs() - header_nsecs);
+            if (statistics)
+                statistics->addTime(LoaderStatistics::STAGE_READ, file->readNsecs());
+            bytes_read = file->bytesRead();
+        } else
+            clock.lap(LoaderStatistics::STAGE_DECODE, -header_nsecs);
+        decoded_pixels = (qint64)image.width() * image.height();
+        source = LoaderStatistics::SOURCE_FILE;
+        if (canceled->loadAcquire())
+            // might be only partly decoded
+            image = QImage();
+        else if (image.isNull())
+            printf("WARNING: Failed to open file %s\n", filename.toStdString().c_str());
+        // The decoders return all kinds of formats (Indexed8, Grayscale8, RGB32, ...), which the
+        // painter would convert each time the tile is drawn. Convert once here, off the GUI thread:
+        image = normalize_image_format(apply_exif_orientation(image, orientation));
+        clock.lap(LoaderStatistics::STAGE_CONVERT);
+        
+        bordercolor = indexed ? info.bordercolor : get_most_prominent_color(image, 5000, canceled);
+        clock.lap(LoaderStatistics::STAGE_COLOR);
+        
+        if (cache && !image.isNull() && !canceled->loadAcquire()) {
+            // the cache stores the same format, so the tiles get the same version next time:
+            cache->insert(filename, tilesize, max_zoom, image, bordercolor);
+            clock.lap(LoaderStatistics::STAGE_STORE);
+        }
+    }
+    // The smaller levels for zoomed-out tiles are not stored on the hdd, they are built much 
+    // faster than the image is decoded:
+    ImagePyramid levels = build_image_pyramid(image, tilesize, canceled);
+    if (statistics) {
+        clock.lap(LoaderStatistics::STAGE_PYRAMID);
+        statistics->addImage(levels.isEmpty() ? LoaderStatistics::SOURCE_FAILED : source, 
+                             bytes_read, decoded_pixels);
+    }
+    return levels;
+}
@@ -0,0 +1,110 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMAGEDECODER_H
+#define IMAGEDECODER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QFile>
+#include <QImageReader>
+#include <QBuffer>
+#include <QScopedPointer>
+#include <QElapsedTimer>
+#include <math.h>
+#include "imagepyramid.h"
+#include "thumbnailcache.h"
+#include "imageindex.h"
+#include "exif.h"
+#include "loaderstatistics.h"
+#include "imagearchive.h"
+#include "packeddeck.h"
+
+// Decoding the images for the tiles, without the tiles themselves (see TileImageHandler), so
+// deckpacker packs the images exactly as the game decodes them.
+
+// Returns image converted to QImage::Format_ARGB32_Premultiplied, the format the raster paint 
+// engine draws without conversion. Images already in this format are returned without a copy.
+QImage normalize_image_format(const QImage &image);
+
+// Returns the most prominent color of image, looking at not more than max_pixel pixels.
+// Returns an invalid color if canceled is given and set meanwhile.
+QColor get_most_prominent_color(const QImage &image, const int max_pixel = 5000, 
+                                const QAtomicInt *canceled = NULL);
+
+// A file opened for reading which fails all reads as soon as *canceled is set. A decoder reading
+// from it gives up in the middle of a big image instead of decoding it completely.
+class CancelableFile : public QFile
+{
+public:
+    CancelableFile(const QString &name, const QAtomicInt *canceled);
+    
+    // The bytes read from the file so far, and the time spent on it:
+    qint64 bytesRead() const { return _bytesRead; };
+    qint64 readNsecs() const { return _readNsecs; };
+    
+protected:
+    virtual qint64 readData(char *data, qint64 maxlen);
+    
+private:
+    const QAtomicInt *_canceled;
+    qint64 _bytesRead, _readNsecs;
+};
+
+// The same for an entry of an image archive, which has been read into data already:
+class CancelableBuffer : public QBuffer
+{
+public:
+    CancelableBuffer(const QByteArray &data, const QAtomicInt *canceled);
+    
+protected:
+    virtual qint64 readData(char *data, qint64 maxlen);
+    
+private:
+    QByteArray _data;
+    const QAtomicInt *_canceled;
+};
+
+// Returns the size to which an image of size original_size must be decoded, so that it is 
+// never up-scaled on a tile of size tilesize: neither when it fills the unzoomed tile nor when 
+// it fits entirely inside the tile zoomed by max_zoom (see Tile::calcImageRects).
+// The image is never enlarged. 
+QSize calc_decode_size(const QSize &original_size, const int tilesize, const double max_zoom);
+
+// Decodes filename (a file or an entry of an image archive, see ImageArchive), or takes it from
+// deck or cache, if given, just big enough for tiles of size tilesize zoomed by max_zoom, turns it upright
+// according to its EXIF orientation, determines its bordercolor (from image_index, if given) and
+// builds its levels. Newly decoded images are added to cache. Returns no levels if the file is 
+// broken or *canceled has been set.
+// If handler is given, a placeholder is sent to it as image index before the file is decoded 
+// (see TileImageHandler::placeholderDecoded), if one can be made much faster than the image.
+// If statistics is given, the time of each stage is added to it.
+ImagePyramid decode_image_levels(const QString &filename, const int tilesize, const double max_zoom, 
+                                 const ImageIndex *image_index, const PackedDeck *deck, ThumbnailCache *cache, 
+                                 const QAtomicInt *canceled, QColor &bordercolor,
+                                 QObject *handler = NULL, const uint index = 0,
+                                 LoaderStatistics *statistics = NULL);
+
+#endif // IMAGEDECODER_H
@@ -0,0 +1,208 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "imagefolderscanner.h"
+
+// The file names found by FolderWalkTask are checked in batches of this size:
+#define FOLDER_SCAN_BATCH_SIZE 64
+// For archive entries, the header check looks at this many bytes:
+#define IMAGE_HEADER_CHECK_SIZE 4096
+
+// The threads of all scans. Not owned by a scanner: its destructor would wait for the tasks.
+Q_GLOBAL_STATIC(QThreadPool, scanner_pool)
+
+
+FolderScan::FolderScan(ImageFolderScanner* scanner, const int id) : 
+_scanner(scanner), _id(id)
+{
+    _canceled.storeRelease(0);
+    // the walk task:
+    _pendingTasks.storeRelease(1);
+}
+
+void FolderScan::cancel()
+{
+    _canceled.storeRelease(1);
+    QMutexLocker locker(&_scannerMutex);
+    _scanner = NULL;
+}
+
+void FolderScan::startTask(QRunnable* task)
+{
+    // counted before the task is started, so _pendingTasks can't drop to zero while walking:
+    _pendingTasks.ref();
+    scanner_pool()->start(task);
+}
+
+void FolderScan::reportBatch(const QStringList& filenames)
+{
+    QMutexLocker locker(&_scannerMutex);
+    if (_scanner)
+        QMetaObject::invokeMethod(_scanner, "batchChecked", Qt::QueuedConnection,
+                                  Q_ARG(int, _id), Q_ARG(QStringList, filenames));
+}
+
+void FolderScan::taskDone()
+{
+    if (_pendingTasks.deref())
+        return;
+    // The results of the tasks have been posted already, so the scanner gets 
+    // scanFinished after all of them:
+    QMutexLocker locker(&_scannerMutex);
+    if (_scanner)
+        QMetaObject::invokeMethod(_scanner, "scanFinished", Qt::QueuedConnection, Q_ARG(int, _id));
+}
+
+
+FolderWalkTask::FolderWalkTask(QSharedPointer<FolderScan> scan, const QString& folder, const bool recursive) :
+_scan(scan), _folder(folder), _recursive(recursive)
+{
+}
+
+void FolderWalkTask::run()
+{
+    QStringList filenamefilter;
+    // get list of supported image formats:
+    QList<QByteArray> sifs(QImageReader::supportedImageFormats());
+    for (int i = 0; i < sifs.count(); i++)
+        filenamefilter << "*." + sifs.at(i);
+    
+    QStringList batch;
+    if (ImageArchive::isArchive(_folder.absolutePath())) {
+        // The entries of an archive are known as soon as it is opened, its folders are 
+        // the names' prefixes:
+        QSharedPointer<ImageArchive> archive = ImageArchive::open(_folder.absolutePath());
+        QStringList entries = archive ? archive->entryNames() : QStringList();
+        QList<QRegExp> patterns;
+        for (int i = 0; i < filenamefilter.count(); i++)
+            patterns << QRegExp(filenamefilter.at(i), Qt::CaseInsensitive, QRegExp::Wildcard);
+        for (int i = 0; i < entries.count() && !_scan->isCanceled(); i++) {
+            if (!_recursive && entries.at(i).contains('/'))
+                continue;
+            for (int j = 0; j < patterns.count(); j++)
+                if (patterns.at(j).exactMatch(entries.at(i).section('/', -1))) {
+                    addToBatch(batch, entries.at(i));
+                    break;
+                }
+        }
+    } else {
+        QDirIterator it(_folder.absolutePath(), filenamefilter, QDir::Files | QDir::Readable,
+                        _recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+        while (it.hasNext() && !_scan->isCanceled())
+            addToBatch(batch, _folder.relativeFilePath(it.next()));
+    }
+    if (!batch.isEmpty() && !_scan->isCanceled())
+        _scan->startTask(new ImageHeaderCheckTask(_scan, _folder, batch));
+    _scan->taskDone();
+}
+
+void FolderWalkTask::addToBatch(QStringList& batch, const QString& filename)
+{
+    batch << filename;
+    if (batch.count() == FOLDER_SCAN_BATCH_SIZE) {
+        _scan->startTask(new ImageHeaderCheckTask(_scan, _folder, batch));
+        batch.clear();
+    }
+}
+
+
+ImageHeaderCheckTask::ImageHeaderCheckTask(QSharedPointer<FolderScan> scan, const QDir& folder, const QStringList& filenames) :
+_scan(scan), _folder(folder), _filenames(filenames)
+{
+}
+
+void ImageHeaderCheckTask::run()
+{
+    QStringList readable;
+    for (int i = 0; i < _filenames.count() && !_scan->isCanceled(); ++i) {
+        QString path = _folder.absoluteFilePath(_filenames.at(i));
+        QSharedPointer<ImageArchive> archive;
+        QString entry;
+        bool can_read;
+        if (ImageArchive::findEntry(path, archive, entry)) {
+            // the header is in the first bytes, only these are inflated:
+            QByteArray header = archive->read(entry, _scan->canceledFlag(), IMAGE_HEADER_CHECK_SIZE);
+            QBuffer buffer(&header);
+            can_read = QImageReader(&buffer, QFileInfo(entry).suffix().toLower().toLatin1()).canRead();
+        } else
+            // only reads the first bytes of the file:
+            can_read = QImageReader(path).canRead();
+        if (can_read)
+            readable << _filenames.at(i);
+    }
+    if (!readable.isEmpty())
+        _scan->reportBatch(readable);
+    _scan->taskDone();
+}
+
+
+ImageFolderScanner::ImageFolderScanner(QObject* parent) : 
+QObject(parent), _scanId(0), _scanning(false)
+{
+    // Reading the headers mostly waits for the disk or network, so it is worth using more threads 
+    // than CPU cores. One more thread walks through the folders:
+    scanner_pool()->setMaxThreadCount(2 * QThread::idealThreadCount() + 1);
+}
+
+ImageFolderScanner::~ImageFolderScanner()
+{
+    cancel();
+}
+
+void ImageFolderScanner::scan(const QString& folder, const bool recursive)
+{
+    cancel();
+    _scanId++;
+    _scanning = true;
+    _scan = QSharedPointer<FolderScan>(new FolderScan(this, _scanId));
+    scanner_pool()->start(new FolderWalkTask(_scan, folder, recursive));
+}
+
+void ImageFolderScanner::cancel()
+{
+    // the tasks stop after the current file and drop the scan:
+    if (_scan)
+        _scan->cancel();
+    _scan.clear();
+    _scanning = false;
+}
+
+void ImageFolderScanner::batchChecked(int scan_id, QStringList filenames)
+{
+    if (scan_id != _scanId || !_scanning)
+        // from a canceled scan
+        return;
+    emit imagesFound(filenames);
+}
+
+void ImageFolderScanner::scanFinished(int scan_id)
+{
+    if (scan_id != _scanId || !_scanning)
+        return;
+    _scanning = false;
+    emit finished();
+}
+
+
+//#include "imagefolderscanner.moc"
@@ -0,0 +1,141 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMAGEFOLDERSCANNER_H
+#define IMAGEFOLDERSCANNER_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QDir>
+#include <QDirIterator>
+#include <QImageReader>
+#include <QBuffer>
+#include <QRegExp>
+#include "imagearchive.h"
+
+class ImageFolderScanner;
+
+// One scan, shared by the ImageFolderScanner and the tasks, so the tasks of a canceled scan can 
+// finish in the background while the scanner goes on with another folder.
+class FolderScan
+{
+public:
+    FolderScan(ImageFolderScanner *scanner, const int id);
+    
+    // Stops the tasks after their current file and detaches the scan from the scanner:
+    void cancel();
+    bool isCanceled() const { return _canceled.loadAcquire() != 0; };
+    // (for reading archive entries)
+    const QAtomicInt *canceledFlag() const { return &_canceled; };
+    // Runs task in the scanner threads:
+    void startTask(QRunnable *task);
+    // Posts readable files to the scanner, unless the scan has been canceled:
+    void reportBatch(const QStringList &filenames);
+    // Called by each task when it is done. The last one reports that the scan has finished:
+    void taskDone();
+    
+private:
+    QAtomicInt _canceled;
+    // number of tasks which have not finished yet:
+    QAtomicInt _pendingTasks;
+    // protects _scanner, which is NULL after cancel():
+    QMutex _scannerMutex;
+    ImageFolderScanner *_scanner;
+    const int _id;
+};
+
+// Walks through a folder (and its subfolders if recursive) and hands the files with the 
+// extension of a supported image format in batches to ImageHeaderCheckTasks. The folder can
+// also be an image archive (see ImageArchive), whose entries are treated like files.
+class FolderWalkTask : public QRunnable
+{
+public:
+    FolderWalkTask(QSharedPointer<FolderScan> scan, const QString &folder, const bool recursive);
+    virtual void run();
+    
+private:
+    // Adds filename to batch and starts a check task once the batch is full:
+    void addToBatch(QStringList &batch, const QString &filename);
+    
+    QSharedPointer<FolderScan> _scan;
+    const QDir _folder;
+    const bool _recursive;
+};
+
+// Checks the headers of a batch of files and reports the ones which can be read to the scanner.
+class ImageHeaderCheckTask : public QRunnable
+{
+public:
+    ImageHeaderCheckTask(QSharedPointer<FolderScan> scan, const QDir &folder, const QStringList &filenames);
+    virtual void run();
+    
+private:
+    QSharedPointer<FolderScan> _scan;
+    const QDir _folder;
+    const QStringList _filenames;
+};
+
+// Finds the image files in a folder in the background. The results are reported in batches while
+// scanning, so the first images can be used long before a big folder (e.g. on a network drive) 
+// has been scanned completely. Whether a file is an image is decided by its extension and a look
+// at its header (QImageReader::canRead), which is done for several files in parallel.
+class ImageFolderScanner : public QObject
+{
+    Q_OBJECT
+    
+public:
+    ImageFolderScanner(QObject *parent = 0);
+    ~ImageFolderScanner();
+    
+    // Starts scanning folder, a running scan is canceled. If recursive, the subfolders are scanned, too.
+    void scan(const QString &folder, const bool recursive);
+    // Stops a running scan, no more results will be reported. Doesn't wait for the tasks:
+    void cancel();
+    bool isScanning() const { return _scanning; };
+    
+signals:
+    // Some more images have been found. filenames are relative to the scanned folder:
+    void imagesFound(const QStringList &filenames);
+    // Emitted after the last imagesFound of a scan:
+    void finished();
+    
+private slots:
+    // Invoked by the tasks of scan scan_id:
+    void batchChecked(int scan_id, QStringList filenames);
+    void scanFinished(int scan_id);
+    
+private:
+    QSharedPointer<FolderScan> _scan;
+    // results of previous scans might still be waiting in the event queue, they are ignored:
+    int _scanId;
+    bool _scanning;
+};
+
+#endif // IMAGEFOLDERSCANNER_H
@@ -0,0 +1,355 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "imageindex.h"
+#include "imagedecoder.h" // for get_most_prominent_color and normalize_image_format
+#include "exif.h"
+
+#define IMAGE_INDEX_MAGIC 0x58444e49 // "INDX"
+#define IMAGE_INDEX_VERSION 1
+// The border color is determined on a version of the image not bigger than this:
+#define IMAGE_INDEX_COLOR_SAMPLE_SIZE 256
+// While updating, the index file is written after this many new entries:
+#define IMAGE_INDEX_FLUSH_INTERVAL 256
+
+// The index file starts with this header, followed by count records and then the name table:
+struct index_header_t {
+    quint32 magic;
+    quint32 version;
+    quint32 count;
+    quint32 names_offset;
+};
+
+
+ImageIndexUpdateTask::ImageIndexUpdateTask(QSharedPointer<ImageIndexFile> file, const QStringList& filenames) :
+_file(file), _filenames(filenames)
+{
+}
+
+void ImageIndexUpdateTask::run()
+{
+    int num_added = 0;
+    for (int i = 0; i < _filenames.count(); ++i) {
+        if (_file->isCanceled())
+            return;
+        // (the folder might be an image archive)
+        QString path = _file->folder().filePath(_filenames.at(i)), canonical_path;
+        qint64 mtime = 0, file_size = 0;
+        image_file_info(path, canonical_path, mtime, file_size);
+        if (_file->isUpToDate(_filenames.at(i), mtime, file_size))
+            continue;
+        
+        image_record_t record;
+        memset(&record, 0, sizeof(record));
+        record.mtime = mtime;
+        record.file_size = file_size;
+        
+        // read the file only once, for the hash and the decoder:
+        QByteArray content = read_image_file(path);
+        QByteArray hash = QCryptographicHash::hash(content, QCryptographicHash::Sha1);
+        memcpy(record.content_hash, hash.constData(), qMin(hash.size(), (int)sizeof(record.content_hash)));
+        
+        QBuffer buffer(&content);
+        QImageReader reader(&buffer);
+        QSize size = reader.size();
+        if (size.isValid()) {
+            record.width = size.width();
+            record.height = size.height();
+            if (qMax(size.width(), size.height()) > IMAGE_INDEX_COLOR_SAMPLE_SIZE)
+                reader.setScaledSize(size.scaled(IMAGE_INDEX_COLOR_SAMPLE_SIZE, IMAGE_INDEX_COLOR_SAMPLE_SIZE, 
+                                                 Qt::KeepAspectRatio));
+        }
+        // Turned upright and in the same format as the images on the tiles, like in
+        // decode_image_levels. The color is computed on the small sample instead of the image
+        // scaled for the tile size, so it may differ slightly from the one without the index
+        // (but it is the same for all tile sizes then):
+        int orientation = 1;
+        QByteArray exif_thumbnail;
+        parse_exif(content.left(EXIF_MAX_HEADER_SIZE), orientation, exif_thumbnail);
+        QImage image = normalize_image_format(apply_exif_orientation(reader.read(), orientation));
+        if (!image.isNull()) {
+            record.valid = 1;
+            if (!size.isValid()) {
+                record.width = image.width();
+                record.height = image.height();
+            }
+            record.bordercolor = get_most_prominent_color(image).rgb();
+        }
+        _file->addRecord(_filenames.at(i), record);
+        
+        // save the progress from time to time:
+        num_added++;
+        if (num_added % IMAGE_INDEX_FLUSH_INTERVAL == 0)
+            _file->flush();
+    }
+    // drop the files that don't exist anymore:
+    _file->flush(&_filenames);
+    _file->notifyFinished();
+}
+
+
+ImageIndexFile::ImageIndexFile(const QString& filename, const QString& folder, ImageIndex* owner) :
+_filename(filename), _folder(folder), _file(NULL), _data(NULL), _owner(owner)
+{
+    _canceled.storeRelease(0);
+    QWriteLocker locker(&_lock);
+    open();
+}
+
+ImageIndexFile::~ImageIndexFile()
+{
+    close();
+}
+
+bool ImageIndexFile::lookup(const QString& name, ImageInfo& info, const bool check_file) const
+{
+    QReadLocker locker(&_lock);
+    const image_record_t *record = findRecord(name);
+    if (!record)
+        return false;
+    if (check_file) {
+        // A changed file might have other dimensions, which must not be used for decoding it:
+        QString canonical_path;
+        qint64 mtime = 0, file_size = 0;
+        if (!image_file_info(_folder.filePath(name), canonical_path, mtime, file_size) ||
+            record->mtime != mtime || record->file_size != file_size)
+            return false;
+    }
+    info.size = QSize(record->width, record->height);
+    info.bordercolor = QColor(record->bordercolor);
+    info.valid = record->valid != 0;
+    info.content_hash = QByteArray(reinterpret_cast<const char*>(record->content_hash), sizeof(record->content_hash));
+    return true;
+}
+
+void ImageIndexFile::open()
+{
+    _file = new QFile(_filename);
+    if (!_file->open(QIODevice::ReadOnly) || _file->size() < (qint64)sizeof(index_header_t) ||
+        !(_data = _file->map(0, _file->size()))) 
+    {
+        // no index yet
+        close();
+        return;
+    }
+    const index_header_t *header = reinterpret_cast<const index_header_t*>(_data);
+    if (header->magic != IMAGE_INDEX_MAGIC || header->version != IMAGE_INDEX_VERSION ||
+        (qint64)sizeof(index_header_t) + (qint64)header->count * (qint64)sizeof(image_record_t) > _file->size() ||
+        (qint64)header->names_offset > _file->size())
+    {
+        printf("WARNING: Ignoring invalid image index %s\n", _filename.toStdString().c_str());
+        close();
+        return;
+    }
+    const image_record_t *records = reinterpret_cast<const image_record_t*>(_data + sizeof(index_header_t));
+    const char *names = reinterpret_cast<const char*>(_data + header->names_offset);
+    qint64 names_size = _file->size() - header->names_offset;
+    _mapped.reserve(header->count);
+    for (quint32 i = 0; i < header->count; ++i) {
+        if ((qint64)records[i].name_offset + records[i].name_length > names_size)
+            continue;
+        _mapped.insert(QString::fromUtf8(names + records[i].name_offset, records[i].name_length), &records[i]);
+    }
+}
+
+void ImageIndexFile::close()
+{
+    _mapped.clear();
+    _data = NULL;
+    // closing the file also unmaps it:
+    delete _file;
+    _file = NULL;
+}
+
+const image_record_t* ImageIndexFile::findRecord(const QString& name) const
+{
+    QHash<QString, image_record_t>::const_iterator fresh = _fresh.constFind(name);
+    if (fresh != _fresh.constEnd())
+        return &fresh.value();
+    return _mapped.value(name, NULL);
+}
+
+bool ImageIndexFile::isUpToDate(const QString& name, const qint64 mtime, const qint64 file_size) const
+{
+    QReadLocker locker(&_lock);
+    const image_record_t *record = findRecord(name);
+    return record && record->mtime == mtime && record->file_size == file_size;
+}
+
+void ImageIndexFile::addRecord(const QString& name, const image_record_t& record)
+{
+    QWriteLocker locker(&_lock);
+    _fresh.insert(name, record);
+}
+
+void ImageIndexFile::flush(const QStringList* keep)
+{
+    QWriteLocker locker(&_lock);
+    bool changed = !_fresh.isEmpty();
+    if (keep && !changed) {
+        // the same number of files might still be other files (e.g. one renamed):
+        changed = keep->count() != _mapped.count();
+        for (int i = 0; i < keep->count() && !changed; ++i)
+            changed = !_mapped.contains(keep->at(i));
+    }
+    if (!changed)
+        return;
+    
+    // collect all names, sorted:
+    QStringList all_names;
+    if (keep)
+        all_names = *keep;
+    else {
+        all_names = _mapped.keys();
+        QHash<QString, image_record_t>::const_iterator it;
+        for (it = _fresh.constBegin(); it != _fresh.constEnd(); ++it)
+            if (!_mapped.contains(it.key()))
+                all_names << it.key();
+    }
+    all_names.sort();
+    
+    // copy everything out of the mapped file, because it will be replaced:
+    QVector<image_record_t> records;
+    records.reserve(all_names.count());
+    QByteArray names;
+    for (int i = 0; i < all_names.count(); ++i) {
+        image_record_t record;
+        if (_fresh.contains(all_names.at(i)))
+            record = _fresh.value(all_names.at(i));
+        else if (_mapped.contains(all_names.at(i)))
+            record = *_mapped.value(all_names.at(i));
+        else
+            // not indexed yet
+            continue;
+        QByteArray name = all_names.at(i).toUtf8();
+        record.name_offset = names.size();
+        record.name_length = name.size();
+        names += name;
+        records.append(record);
+    }
+    
+    index_header_t header;
+    header.magic = IMAGE_INDEX_MAGIC;
+    header.version = IMAGE_INDEX_VERSION;
+    header.count = records.count();
+    header.names_offset = sizeof(header) + records.count() * sizeof(image_record_t);
+    
+    QSaveFile file(_filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        printf("WARNING: Could not write image index %s\n", _filename.toStdString().c_str());
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.constData()), records.count() * sizeof(image_record_t));
+    file.write(names);
+    // some systems can't replace a mapped file:
+    close();
+    if (!file.commit())
+        printf("WARNING: Could not write image index %s\n", _filename.toStdString().c_str());
+    else
+        _fresh.clear();
+    open();
+}
+
+void ImageIndexFile::cancel()
+{
+    _canceled.storeRelease(1);
+    QMutexLocker locker(&_owner_mutex);
+    _owner = NULL;
+}
+
+void ImageIndexFile::notifyFinished()
+{
+    QMutexLocker locker(&_owner_mutex);
+    // (a queued call is dropped if the owner is deleted before it is delivered)
+    if (_owner)
+        QMetaObject::invokeMethod(_owner, "updateFinished", Qt::QueuedConnection);
+}
+
+
+ImageIndex::ImageIndex(const QString& index_dir, QObject* parent) : 
+QObject(parent), _index_dir(index_dir), _updating(false)
+{
+    if (!_index_dir.mkpath(_index_dir.absolutePath()))
+        printf("WARNING: Could not create image index directory %s\n", 
+               _index_dir.absolutePath().toStdString().c_str());
+}
+
+ImageIndex::~ImageIndex()
+{
+    // a running task keeps the file until it has noticed:
+    cancelUpdate();
+}
+
+QString ImageIndex::relativeName(const QString& filename)
+{
+    return filename.startsWith("img:") ? filename.mid(4) : filename;
+}
+
+void ImageIndex::setFolder(const QString& folder, const QStringList& filenames)
+{
+    cancelUpdate();
+    
+    QStringList relative_names;
+    relative_names.reserve(filenames.count());
+    for (int i = 0; i < filenames.count(); ++i)
+        relative_names << relativeName(filenames.at(i));
+    
+    QString absolute_folder = QDir(folder).absolutePath();
+    QString index_filename = _index_dir.filePath(QString::fromLatin1(
+        QCryptographicHash::hash(absolute_folder.toUtf8(), QCryptographicHash::Sha1).toHex()) + ".idx");
+    QSharedPointer<ImageIndexFile> file(new ImageIndexFile(index_filename, absolute_folder, this));
+    {
+        QMutexLocker locker(&_mutex);
+        _file = file;
+    }
+    
+    _updating = true;
+    // Not a pool of our own: its destructor would wait for a canceled task.
+    QThreadPool::globalInstance()->start(new ImageIndexUpdateTask(file, relative_names));
+}
+
+bool ImageIndex::lookup(const QString& filename, ImageInfo& info, const bool check_file) const
+{
+    QSharedPointer<ImageIndexFile> file;
+    {
+        QMutexLocker locker(&_mutex);
+        file = _file;
+    }
+    return file && file->lookup(relativeName(filename), info, check_file);
+}
+
+void ImageIndex::updateFinished()
+{
+    _updating = false;
+    emit updated();
+}
+
+void ImageIndex::cancelUpdate()
+{
+    QMutexLocker locker(&_mutex);
+    if (_file)
+        _file->cancel();
+    _updating = false;
+}
@@ -0,0 +1,180 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMAGEINDEX_H
+#define IMAGEINDEX_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QBuffer>
+#include <QImageReader>
+#include <QCryptographicHash>
+#include <QColor>
+#include <QSize>
+#include <stdio.h> // for printf()
+#include <string.h> // for memset(), memcpy()
+#include "imagearchive.h"
+
+// What the index knows about one image file:
+struct ImageInfo {
+    QSize size; // original dimensions
+    QColor bordercolor; // see get_most_prominent_color
+    bool valid; // false if the file could not be decoded
+    QByteArray content_hash; // SHA-1 of the file contents
+};
+
+// One fixed-size record per image in the index file:
+struct image_record_t {
+    qint64 mtime; // modification time of the file in ms since epoch
+    qint64 file_size;
+    qint32 width, height;
+    QRgb bordercolor;
+    quint32 valid;
+    quint8 content_hash[20];
+    quint32 name_offset, name_length; // file name (UTF-8) in the name table
+    quint32 reserved;
+};
+
+class ImageIndex;
+
+// The index file of one folder with its records. It is shared by the ImageIndex and the update task,
+// so a canceled task can finish in the background while the ImageIndex goes on with another folder.
+// All methods are thread-safe.
+class ImageIndexFile
+{
+public:
+    ImageIndexFile(const QString &filename, const QString &folder, ImageIndex *owner);
+    ~ImageIndexFile();
+    
+    const QDir &folder() const { return _folder; };
+    // see ImageIndex::lookup, name is relative to the folder:
+    bool lookup(const QString &name, ImageInfo &info, const bool check_file) const;
+    // Returns true if the index has an entry for name with the same modification time and size:
+    bool isUpToDate(const QString &name, const qint64 mtime, const qint64 file_size) const;
+    // Adds or replaces the entry of name (called from the update task):
+    void addRecord(const QString &name, const image_record_t &record);
+    // Writes all entries to the index file and maps it again. If keep is given, only these 
+    // entries are kept:
+    void flush(const QStringList *keep = NULL);
+    
+    // Stops the update and detaches the file from its ImageIndex, without waiting for the task:
+    void cancel();
+    bool isCanceled() const { return _canceled.loadAcquire() != 0; };
+    // Tells the ImageIndex that the update has finished, unless it has been canceled:
+    void notifyFinished();
+    
+private:
+    // Maps the index file. _lock must be locked for writing.
+    void open();
+    void close();
+    // Returns the record of name or NULL. _lock must be locked.
+    const image_record_t *findRecord(const QString &name) const;
+    
+    const QString _filename;
+    // the folder of the images:
+    const QDir _folder;
+    QFile *_file;
+    const uchar *_data;
+    // the records in the mapped file:
+    QHash<QString, const image_record_t*> _mapped;
+    // records that have been added since the file was mapped:
+    QHash<QString, image_record_t> _fresh;
+    mutable QReadWriteLock _lock;
+    
+    QAtomicInt _canceled;
+    // protects _owner, which is NULL after cancel():
+    QMutex _owner_mutex;
+    ImageIndex *_owner;
+};
+
+// Updates the index of a folder in the background: only files which are new or have 
+// changed since the last update are read.
+class ImageIndexUpdateTask : public QRunnable
+{
+public:
+    ImageIndexUpdateTask(QSharedPointer<ImageIndexFile> file, const QStringList &filenames);
+    virtual void run();
+    
+private:
+    QSharedPointer<ImageIndexFile> _file;
+    const QStringList _filenames;
+};
+
+// A compact index with the metadata of all images in an image folder (dimensions, border color,
+// whether it can be decoded at all and a hash of its contents), so this does not need to be 
+// found out again every game. Each folder has its own index file, which is memory-mapped.
+// Lookups are thread-safe.
+class ImageIndex : public QObject
+{
+    Q_OBJECT
+    
+public:
+    // The index files are saved in directory index_dir, which is created if necessary.
+    ImageIndex(const QString &index_dir, QObject *parent = 0);
+    ~ImageIndex();
+    
+    // Opens the index of folder and starts updating it in the background for filenames (relative to
+    // folder, or prefixed with the search path "img:"). Files not in filenames are dropped from the index.
+    void setFolder(const QString &folder, const QStringList &filenames);
+    
+    // Returns false if filename (relative to the folder or prefixed with "img:") has not been indexed yet,
+    // or, if check_file is true, if the file has changed since (its modification time or size differ).
+    // Without checking, no file is touched, but the record might be outdated until the update is done.
+    bool lookup(const QString &filename, ImageInfo &info, const bool check_file = true) const;
+    
+    bool isUpdating() const { return _updating; };
+    
+signals:
+    // Emitted after the background update of the index has finished:
+    void updated();
+    
+private slots:
+    void updateFinished();
+    
+private:
+    // Removes the search path prefix:
+    static QString relativeName(const QString &filename);
+    // Stops a running update. The task finishes in the background.
+    void cancelUpdate();
+    
+    QDir _index_dir;
+    // the index of the current folder, NULL before setFolder():
+    QSharedPointer<ImageIndexFile> _file;
+    // protects _file, lookups come from the decoder threads:
+    mutable QMutex _mutex;
+    bool _updating;
+};
+
+#endif // IMAGEINDEX_H
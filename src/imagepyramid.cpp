@@ -0,0 +1,46 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "imagepyramid.h"
+
+
+ImagePyramid build_image_pyramid(const QImage &image, const int tilesize, const QAtomicInt *canceled)
+{
+    ImagePyramid levels;
+    if (image.isNull())
+        return levels;
+    levels.append(image);
+    // Each level has half the area of the previous one, so a tile is never drawn from a source
+    // more than twice as big as needed. The smallest level still fits the unzoomed tile:
+    forever {
+        const QImage &last = levels.last();
+        QSize size(last.width() / sqrt(2.0), last.height() / sqrt(2.0));
+        if (size.isEmpty() || fmax(size.width(), size.height()) < tilesize ||
+            (canceled && canceled->loadAcquire()))
+            break;
+        // scaled from the previous level, so every level is filtered from one about twice its size:
+        levels.append(last.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    }
+    return levels;
+}
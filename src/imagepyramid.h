@@ -0,0 +1,44 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IMAGEPYRAMID_H
+#define IMAGEPYRAMID_H
+
+#include <QVector>
+#include <QImage>
+#include <QAtomicInt>
+#include <math.h>
+
+// The face image of a tile in decreasing resolutions, each level with half the area of the 
+// previous one (see build_image_pyramid). While a tile is zoomed, it is drawn from the smallest 
+// level that does not need to be up-scaled, so the painter never resamples a much bigger image.
+// Level 0 is the full resolution; the levels are implicitly shared like QImage.
+typedef QVector<QImage> ImagePyramid;
+
+// Returns image and versions of it scaled down in steps, the smallest still big enough for 
+// an unzoomed tile of size tilesize (see ImagePyramid). Returns no levels if image is null.
+// Stops with the levels built so far if canceled is given and set meanwhile.
+ImagePyramid build_image_pyramid(const QImage &image, const int tilesize, const QAtomicInt *canceled = NULL);
+
+#endif // IMAGEPYRAMID_H
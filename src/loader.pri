@@ -0,0 +1,36 @@
+# The image loading code, shared by the game and its tools (see ../Memoria.pro). Include it 
+# after setting TARGET.
+
+# (the game and the tools are built in the same folder)
+OBJECTS_DIR = obj/$$TARGET
+MOC_DIR = moc/$$TARGET
+RCC_DIR = rcc/$$TARGET
+
+SOURCES += imagedecoder.cpp \
+           imagepyramid.cpp \
+           thumbnailcache.cpp \
+           imageindex.cpp \
+           exif.cpp \
+           loaderstatistics.cpp \
+           imagearchive.cpp \
+           packeddeck.cpp
+
+HEADERS  += imagedecoder.h \
+    imagepyramid.h \
+    thumbnailcache.h \
+    imageindex.h \
+    exif.h \
+    loaderstatistics.h \
+    imagearchive.h \
+    packeddeck.h
+
+# zlib for inflating the entries of image archives (see imagearchive.cpp). The one Qt has been 
+# built with is used, so nothing else needs to be installed: a Qt with its own zlib (e.g. on 
+# Windows) exports it from QtCore, otherwise Qt uses the zlib of the system.
+contains(QT_CONFIG, system-zlib) {
+    unix|mingw: LIBS += -lz
+    else: LIBS += zdll.lib
+} else {
+    greaterThan(QT_MAJOR_VERSION, 4): QT += zlib-private
+    else: INCLUDEPATH += $$[QT_INSTALL_PREFIX]/src/3rdparty/zlib
+}
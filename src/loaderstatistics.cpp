@@ -0,0 +1,119 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "loaderstatistics.h"
+
+static const char *stage_names[LoaderStatistics::NUM_STAGES] = {
+    "queue wait", "lookup", "placeholder", "read", "decode", 
+    "convert", "color", "store", "pyramid", "delivery"
+};
+
+
+LoaderStatistics::LoaderStatistics()
+{
+    reset();
+}
+
+void LoaderStatistics::addTime(const Stage stage, const qint64 nsecs)
+{
+    QMutexLocker locker(&_mutex);
+    _counts[stage]++;
+    _totalTimes[stage] += nsecs;
+    if (nsecs > _maxTimes[stage])
+        _maxTimes[stage] = nsecs;
+}
+
+void LoaderStatistics::addImage(const Source source, const qint64 bytes_read, const qint64 decoded_pixels)
+{
+    QMutexLocker locker(&_mutex);
+    _imageCounts[source]++;
+    _bytesRead += bytes_read;
+    _decodedPixels += decoded_pixels;
+}
+
+void LoaderStatistics::reset()
+{
+    QMutexLocker locker(&_mutex);
+    for (int i = 0; i < NUM_STAGES; ++i)
+        _counts[i] = _totalTimes[i] = _maxTimes[i] = 0;
+    for (int i = 0; i < NUM_SOURCES; ++i)
+        _imageCounts[i] = 0;
+    _bytesRead = _decodedPixels = 0;
+}
+
+qint64 LoaderStatistics::count(const Stage stage) const
+{
+    QMutexLocker locker(&_mutex);
+    return _counts[stage];
+}
+
+qint64 LoaderStatistics::totalTime(const Stage stage) const
+{
+    QMutexLocker locker(&_mutex);
+    return _totalTimes[stage];
+}
+
+qint64 LoaderStatistics::maxTime(const Stage stage) const
+{
+    QMutexLocker locker(&_mutex);
+    return _maxTimes[stage];
+}
+
+qint64 LoaderStatistics::imageCount(const Source source) const
+{
+    QMutexLocker locker(&_mutex);
+    return _imageCounts[source];
+}
+
+qint64 LoaderStatistics::bytesRead() const
+{
+    QMutexLocker locker(&_mutex);
+    return _bytesRead;
+}
+
+qint64 LoaderStatistics::decodedPixels() const
+{
+    QMutexLocker locker(&_mutex);
+    return _decodedPixels;
+}
+
+QString LoaderStatistics::report() const
+{
+    QMutexLocker locker(&_mutex);
+    QString text;
+    text += QString("images: %1 from memory cache, %2 from deck, %3 from thumbnail cache, %4 decoded, %5 failed\n")
+            .arg(_imageCounts[SOURCE_MEMORY_CACHE]).arg(_imageCounts[SOURCE_DECK]).arg(_imageCounts[SOURCE_THUMBNAIL_CACHE])
+            .arg(_imageCounts[SOURCE_FILE]).arg(_imageCounts[SOURCE_FAILED]);
+    text += QString("read %1 MB, decoded %2 megapixels\n")
+            .arg(_bytesRead / (1024.0 * 1024.0), 0, 'f', 1).arg(_decodedPixels / 1e6, 0, 'f', 1);
+    text += QString("%1 %2 %3 %4 %5\n").arg("stage", -12).arg("count", 7)
+            .arg("total ms", 10).arg("avg ms", 8).arg("max ms", 8);
+    for (int i = 0; i < NUM_STAGES; ++i) {
+        double avg = _counts[i] > 0 ? _totalTimes[i] / (double)_counts[i] : 0.0;
+        text += QString("%1 %2 %3 %4 %5\n").arg(stage_names[i], -12).arg(_counts[i], 7)
+                .arg(_totalTimes[i] / 1e6, 10, 'f', 1).arg(avg / 1e6, 8, 'f', 2)
+                .arg(_maxTimes[i] / 1e6, 8, 'f', 2);
+    }
+    return text;
+}
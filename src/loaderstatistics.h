@@ -0,0 +1,113 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOADERSTATISTICS_H
+#define LOADERSTATISTICS_H
+
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QString>
+
+// Collects how long the image loader spends in each stage of loading an image and how much 
+// work it does, summed up over all images since the last reset. This tells whether slow boards 
+// come from the disk, the decoder or the post-processing. All public methods are thread-safe.
+class LoaderStatistics
+{
+public:
+    // The stages of loading an image, in the order they happen:
+    enum Stage {
+        STAGE_QUEUE_WAIT,  // from queuing the image until a worker takes it
+        STAGE_LOOKUP,      // image index and caches
+        STAGE_PLACEHOLDER, // EXIF thumbnail or scaled decode shown until the image is ready
+        STAGE_READ,        // reading the file
+        STAGE_DECODE,      // decoding, without the time spent reading the file
+        STAGE_CONVERT,     // orientation and pixel format
+        STAGE_COLOR,       // border color (see get_most_prominent_color)
+        STAGE_STORE,       // writing to the thumbnail cache
+        STAGE_PYRAMID,     // scaled-down levels
+        STAGE_DELIVERY,    // from the decoded image until the tiles have got it
+        NUM_STAGES
+    };
+    // Where an image came from:
+    enum Source {
+        SOURCE_MEMORY_CACHE,
+        SOURCE_DECK, // see PackedDeck
+        SOURCE_THUMBNAIL_CACHE,
+        SOURCE_FILE,
+        SOURCE_FAILED, // broken file or canceled
+        NUM_SOURCES
+    };
+    
+    LoaderStatistics();
+    
+    void addTime(const Stage stage, const qint64 nsecs);
+    // Counts an image loaded from source, for which bytes_read bytes have been read from
+    // its file and decoded_pixels pixels decoded:
+    void addImage(const Source source, const qint64 bytes_read = 0, const qint64 decoded_pixels = 0);
+    void reset();
+    
+    // Number of times a stage was passed, the time spent in it, and the longest time (in ns):
+    qint64 count(const Stage stage) const;
+    qint64 totalTime(const Stage stage) const;
+    qint64 maxTime(const Stage stage) const;
+    qint64 imageCount(const Source source) const;
+    qint64 bytesRead() const;
+    qint64 decodedPixels() const;
+    
+    // Returns all statistics as a table in plain text, e.g. for printing:
+    QString report() const;
+    
+private:
+    qint64 _counts[NUM_STAGES], _totalTimes[NUM_STAGES], _maxTimes[NUM_STAGES];
+    qint64 _imageCounts[NUM_SOURCES];
+    qint64 _bytesRead, _decodedPixels;
+    mutable QMutex _mutex;
+};
+
+// Measures the time of consecutive stages. Does nothing if statistics is NULL.
+class StageClock
+{
+public:
+    StageClock(LoaderStatistics *statistics) : _statistics(statistics) { _clock.start(); };
+    
+    // Adds the time since the last lap (or the construction) to stage, leaving out 
+    // exclude_nsecs (e.g. the time of a nested stage which is counted separately):
+    void lap(const LoaderStatistics::Stage stage, const qint64 exclude_nsecs = 0) {
+        if (_statistics)
+            _statistics->addTime(stage, _clock.nsecsElapsed() - exclude_nsecs);
+        _clock.start();
+    };
+    // Returns the time since the last lap and starts the next one, without adding it anywhere:
+    qint64 split() {
+        qint64 nsecs = _clock.nsecsElapsed();
+        _clock.start();
+        return nsecs;
+    };
+    
+private:
+    LoaderStatistics *_statistics;
+    QElapsedTimer _clock;
+};
+
+#endif // LOADERSTATISTICS_H
@@ -24,7 +24,7 @@
 
 #include "memory.h"
 
-Memory::Memory() : _the_AI(NULL), _verbose(!true)
+Memory::Memory() : _the_AI(NULL), _new_dialog(NULL), _verbose(!true)
 {
     setWindowTitle(QCoreApplication::applicationName());
     
@@ -47,6 +47,11 @@ Memory::Memory() : _the_AI(NULL), _verbose(!true)
     QSettings::setDefaultFormat(QSettings::IniFormat);
     readSettings();
     
+    // The metadata of the images is kept in an index next to the INI file:
+    _image_index = new ImageIndex(QFileInfo(QSettings().fileName()).absolutePath() + "/index", this);
+    _the_view->setImageIndex(_image_index);
+    connect(_image_index, SIGNAL(updated()), this, SLOT(imageIndexUpdated()));
+    
     // connect signals:
     connect(_the_view, SIGNAL(matchFound()),
             this,  SLOT(matchFound()));
@@ -71,6 +76,16 @@ Memory::Memory() : _the_AI(NULL), _verbose(!true)
     connect(a, SIGNAL(triggered()), SLOT(changeImageFolder()) );
     filemenu->addAction(a);
     
+    a = new QAction(this);
+    a->setText(tr("&Open image deck"));
+    connect(a, SIGNAL(triggered()), SLOT(openImageDeck()) );
+    filemenu->addAction(a);
+    
+    a = new QAction(this);
+    a->setText(tr("Loader &statistics"));
+    connect(a, SIGNAL(triggered()), SLOT(showLoaderStatistics()) );
+    filemenu->addAction(a);
+    
     filemenu->addSeparator();
     a = new QAction(this);
     a->setText(tr("&Quit")); 
@@ -81,37 +96,23 @@ Memory::Memory() : _the_AI(NULL), _verbose(!true)
     // write default value to ini:
     if (!settings.contains("path_to_images"))
         settings.setValue("path_to_images", tr("./images"));
+    if (!settings.contains("scan_subfolders"))
+        settings.setValue("scan_subfolders", false);
     QString path = settings.value("path_to_images").toString();
     QDir dir(QApplication::applicationDirPath());
     dir.setPath(path); // this can be an absolute path or relative path to applicationDirPath
     path = dir.absolutePath();
     
-    // load the images:
-    setImagePath(path);
-    printf("found %i image files in %s.\n", _image_file_names.count(), path.toStdString().c_str());
-    bool cancelled = false;
-    while (_image_file_names.count() < 2 && !cancelled) {
-        QMessageBox::warning(this, QCoreApplication::applicationName(),
-                             tr("No or not enough images were found in the folder %1.\n\n").arg(path) +
-                             tr("In the following, you can select another folder with images."));
-        path = QFileDialog::getExistingDirectory(this, tr("Select image folder"), path);
-        if (path.isEmpty()) {
-            // user cancelled:
-            cancelled = true;
-        }
-        else {
-            // try again with new path:
-            setImagePath(path);
-            printf("found %i image files in %s.\n", _image_file_names.count(), path.toStdString().c_str());
-            if (_image_file_names.count() >= 2) {
-                // save the new path to config file:
-                settings.setValue("path_to_images", path);
-            }
-        }
-    }
+    // create dialog for new game options, the number of pairs is updated while the images are found:
+    _new_dialog = new NewGameDialog(0, this);
     
-    // create dialog for new game options:
-    _new_dialog = new NewGameDialog(_image_file_names.count(), this);
+    // find the images in the background, so the window shows up immediately:
+    _scanner = new ImageFolderScanner(this);
+    connect(_scanner, SIGNAL(imagesFound(QStringList)), this, SLOT(imagesFound(QStringList)));
+    connect(_scanner, SIGNAL(finished()), this, SLOT(folderScanned()));
+    _save_image_path = false;
+    _game_pending = false;
+    setImagePath(path);
 
     _player1_high_score = settings.value("High_score", 0.0).toInt();
 }
@@ -119,26 +120,95 @@ Memory::Memory() : _the_AI(NULL), _verbose(!true)
 void Memory::setImagePath(const QString path)
 {
     _image_path = QDir(path);
-    QStringList filenamefilter, found_files;
-    // get list of supported image formats:
-    QList<QByteArray> sifs(QImageReader::supportedImageFormats());
-    for (int i = 0; i < sifs.count(); i++) {
-        filenamefilter << "*." + sifs.at(i);
-        // this can be uncommented to print supported files:
-        //printf("%s\n", filenamefilter.at(i).toStdString().c_str());
-    }
-    found_files = _image_path.entryList(filenamefilter, QDir::Files | QDir::Readable);
+    _image_archive = ImageArchive::isArchive(path) ? ImageArchive::open(path) : QSharedPointer<ImageArchive>();
     _image_file_names.clear();
-    for (int i = 0; i < found_files.count(); i++)
-        _image_file_names << "img:" + found_files.at(i);
+    _new_dialog->setMaxPairs(0);
     QDir::setSearchPaths("img", QStringList(_image_path.absolutePath()));
+    // a deck packed from the folder in advance (see deckpacker):
+    _the_view->packedDeck()->open(PackedDeck::fileName(_image_path.absolutePath()));
+    // The files are added in imagesFound while the folder is scanned, 
+    // folderScanned checks the result:
+    QSettings settings;
+    _scanner->scan(_image_path.absolutePath(), settings.value("scan_subfolders", false).toBool());
+}
+
+void Memory::imagesFound(const QStringList &filenames)
+{
+    for (int i = 0; i < filenames.count(); i++)
+        _image_file_names << "img:" + filenames.at(i);
+    // a game can be started as soon as there are enough images:
+    _new_dialog->setMaxPairs(_image_file_names.count());
+    if (_game_pending && _image_file_names.count() >= 2) {
+        _game_pending = false;
+        // not from within the scanner's signal:
+        QTimer::singleShot(0, this, SLOT(startPendingGame()));
+    }
+}
+
+void Memory::folderScanned()
+{
+    QString path = _image_path.absolutePath();
+    printf("found %i image files in %s.\n", _image_file_names.count(), path.toStdString().c_str());
+    // update the metadata of new or changed images in the background:
+    _image_index->setFolder(path, _image_file_names);
+    
+    QSettings settings;
+    if (_image_file_names.count() >= 2) {
+        if (_save_image_path)
+            // save the new path to config file:
+            settings.setValue("path_to_images", path);
+        if (!_previous_image_path.isEmpty())
+            QMessageBox::information(this, QCoreApplication::applicationName(),
+                tr("Found %1 images in the new folder.\n").arg(_image_file_names.count()) +
+                tr("The new images will be used the next time you start a new game."));
+        _save_image_path = false;
+        _previous_image_path.clear();
+        return;
+    }
+    
+    if (_previous_image_path.isEmpty())
+        QMessageBox::warning(this, QCoreApplication::applicationName(),
+                             tr("No or not enough images were found in the folder %1.\n\n").arg(path) +
+                             tr("In the following, you can select another folder with images."));
+    else
+        QMessageBox::warning(this, QCoreApplication::applicationName(),
+                             tr("No or not enough images were found in the folder %1.\n\n").arg(path) +
+                             tr("Please select another folder with images."));
+    path = QFileDialog::getExistingDirectory(this, tr("Select image folder"), path);
+    if (!path.isEmpty()) {
+        // try again with new path:
+        _save_image_path = true;
+        setImagePath(path);
+    }
+    else if (!_previous_image_path.isEmpty()) {
+        // user canceled, revert to previous path:
+        path = _previous_image_path;
+        _previous_image_path.clear();
+        _save_image_path = false;
+        setImagePath(path);
+    }
+    else if (_game_pending) {
+        // there are no images to play with
+        _game_pending = false;
+        if (_the_view->is_game_over())
+            QApplication::exit();
+    }
+}
+
+void Memory::startPendingGame()
+{
+    if (!startNewGame() && _the_view->is_game_over())
+        QApplication::exit();
 }
 
 bool Memory::startNewGame()
 {
     if (_image_file_names.count() < 2) {
-        // must have some images in order to start a game
-        return false;
+        // If the image folder is still being scanned, the game starts once there are enough images
+        // (see imagesFound). Otherwise, there must be some images in order to start a game.
+        // (folderScanned might start scanning another folder.)
+        _game_pending = _scanner->isScanning();
+        return _game_pending;
     }
     // pause timer if it was running (so we can continue if startNewGame dialog is cancelled):
     bool timer_was_running = _the_view->isTimerRunning();
@@ -210,48 +280,34 @@ bool Memory::startNewGame()
 }
 
 void Memory::changeImageFolder() {
-    // backup previous path in case of invalid new path:
-    QString path = _image_path.absolutePath(), previous_path = path;
-    _image_file_names.clear();
-    QSettings settings;
+    QString path = QFileDialog::getExistingDirectory(this, tr("Select image folder"), _image_path.absolutePath());
+    if (path.isEmpty())
+        // user cancelled
+        return;
+    // backup previous path in case of invalid new path (see folderScanned):
+    _previous_image_path = _image_path.absolutePath();
+    _save_image_path = true;
+    setImagePath(path);
+}
 
-    // load the images:
-    bool cancelled = false;
-    while (_image_file_names.count() < 2 && !cancelled) {
-        path = QFileDialog::getExistingDirectory(this, tr("Select image folder"), path);
-        if (path.isEmpty()) {
-            // user cancelled:
-            cancelled = true;
-        }
-        else {
-            // try new path:
-            setImagePath(path);
-            printf("found %i image files in %s.\n", _image_file_names.count(), path.toStdString().c_str());
-            if (_image_file_names.count() >= 2) {
-                // save the new path to config file:
-                settings.setValue("path_to_images", path);
-            }
-            else {
-                QMessageBox::warning(this, QCoreApplication::applicationName(),
-                     tr("No or not enough images were found in the folder %1.\n\n").arg(path) +
-                     tr("Please select another folder with images."));
-            }
-        }
-    }
-    if (cancelled) {
-        // user canceled, revert to previous path:
-        path = previous_path;
-        setImagePath(path);
-        printf("found %i image files in %s.\n", _image_file_names.count(), path.toStdString().c_str());
-    }
-    else {
-        QMessageBox::information(this, QCoreApplication::applicationName(),
-            tr("Found %1 images in the new folder.\n").arg(_image_file_names.count()) +
-            tr("The new images will be used the next time you start a new game."));
-    }
+void Memory::openImageDeck() {
+    QString path = QFileDialog::getOpenFileName(this, tr("Select image deck"), _image_path.absolutePath(),
+                                                tr("Image decks (*.zip *.tar)"));
+    if (path.isEmpty())
+        // user cancelled
+        return;
+    // The archive is used like a folder, its entries like files:
+    _previous_image_path = _image_path.absolutePath();
+    _save_image_path = true;
+    setImagePath(path);
+}
 
-    // update dialog for new game options:
-    _new_dialog->setMaxPairs(_image_file_names.count());
+void Memory::showLoaderStatistics()
+{
+    // the report is a table, which needs a fixed-width font:
+    QMessageBox::information(this, tr("Loader statistics"), 
+                             tr("Image loader statistics (%1):").arg(_image_path.absolutePath().toHtmlEscaped()) +
+                             "<pre>" + _the_view->loaderStatistics()->report().toHtmlEscaped() + "</pre>");
 }
 
 void Memory::matchFound()
@@ -347,6 +403,22 @@ void Memory::imagesLoaded() {
         this, SLOT(imagesLoaded()));
 }
 
+void Memory::imageIndexUpdated()
+{
+    if (!_new_dialog)
+        return;
+    // images which can't be decoded won't be used in a game:
+    int num_valid = 0;
+    for (int i = 0; i < _image_file_names.count(); ++i) {
+        ImageInfo info;
+        if (!_image_index->lookup(_image_file_names.at(i), info, false) || info.valid)
+            num_valid++;
+    }
+    if (num_valid < _image_file_names.count())
+        printf("%i of the image files can't be used.\n", _image_file_names.count() - num_valid);
+    _new_dialog->setMaxPairs(num_valid);
+}
+
 void Memory::closeEvent(QCloseEvent* event)
 {
     //if (userReallyWantsToQuit()) {
@@ -36,8 +36,10 @@
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QFontDatabase>
+#include <QTimer>
 #include "memoryview.h"
 #include "newgamedialog.h"
+#include "imagefolderscanner.h"
 #include "MemoryAI.h"
 
 class Memory : public QMainWindow
@@ -47,11 +49,18 @@ class Memory : public QMainWindow
     
 public:
     Memory();
+    // Starts scanning path for images in the background:
     void setImagePath(const QString path);
     
 public slots:
+    // Returns false if there are no images or the dialog was cancelled. While the images are still
+    // being found, returns true and starts the game as soon as there are enough (see startPendingGame):
     bool startNewGame();
     void changeImageFolder();
+    // The same for an image deck in a ZIP or TAR archive (see ImageArchive):
+    void openImageDeck();
+    // Shows how long loading the images has taken so far, stage by stage:
+    void showLoaderStatistics();
     void matchFound();
     void matchFailed(); // TODO: differ between unlucky fail and fail if correct cards should have been known.
     
@@ -61,6 +70,15 @@ public slots:
     void boardReady();
     void imagesLoaded();
     
+private slots:
+    // the background update of the image index has finished:
+    void imageIndexUpdated();
+    // receive the results of the image folder scanner:
+    void imagesFound(const QStringList &filenames);
+    void folderScanned();
+    // the game asked for before there were enough images. Quits if there is no game to go back to:
+    void startPendingGame();
+    
 protected:
     virtual void closeEvent(QCloseEvent* event);
     
@@ -85,8 +103,18 @@ private:
     
     MemoryView *_the_view;
     MemoryAI *_the_AI;
+    ImageIndex *_image_index;
+    ImageFolderScanner *_scanner;
     QDir _image_path;
+    // keeps the image deck open while it is played with, if _image_path is one (see ImageArchive::open):
+    QSharedPointer<ImageArchive> _image_archive;
     QStringList _image_file_names;
+    // While a folder chosen by the user is scanned: the folder to go back to if it has not 
+    // enough images (empty at program start), and whether to save it in the settings:
+    QString _previous_image_path;
+    bool _save_image_path;
+    // startNewGame has been called while there were not enough images yet:
+    bool _game_pending;
     NewGameDialog *_new_dialog;
     PLAYER _current_player;
     OPPONENT _opponent;
@@ -4,139 +4,139 @@
 <context>
     <name>Memory</name>
     <message>
-        <location filename="memory.cpp" line="37"/>
+        <location filename="memory.cpp" line="66"/>
         <source>&amp;File</source>
         <translation>&amp;Datei</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="40"/>
+        <location filename="memory.cpp" line="69"/>
         <source>&amp;New game</source>
         <oldsource>&amp;New Game</oldsource>
         <translation>&amp;Neues Spiel</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="46"/>
+        <location filename="memory.cpp" line="75"/>
         <source>&amp;Change image folder</source>
         <translation>Bilder&amp;ordner wählen</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="52"/>
+        <location filename="memory.cpp" line="91"/>
         <source>&amp;Quit</source>
         <translation>Be&amp;enden</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="59"/>
+        <location filename="memory.cpp" line="98"/>
         <source>./images</source>
         <translation>./Bilder</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="73"/>
-        <location filename="memory.cpp" line="197"/>
+        <location filename="memory.cpp" line="177"/>
+        <location filename="memory.cpp" line="283"/>
         <source>Select image folder</source>
         <translation>Wähle Bilderordner</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="163"/>
+        <location filename="memory.cpp" line="257"/>
         <source>load failed</source>
         <translation>Fehler beim Laden</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="177"/>
-        <location filename="memory.cpp" line="412"/>
-        <location filename="memory.cpp" line="500"/>
+        <location filename="memory.cpp" line="271"/>
+        <location filename="memory.cpp" line="508"/>
+        <location filename="memory.cpp" line="597"/>
         <source>Player 1</source>
         <oldsource>Spieler 1</oldsource>
         <translation>Spieler 1</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="213"/>
+        <location filename="memory.cpp" line="176"/>
         <source>Please select another folder with images.</source>
         <translation>Bitte wähle einen anderen Ordner mit Bildern.</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="225"/>
+        <location filename="memory.cpp" line="162"/>
         <source>Found %1 images in the new folder.
 </source>
         <translation>Im neuen Ordner wurden %1 Bilder gefunden.
 </translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="226"/>
+        <location filename="memory.cpp" line="163"/>
         <source>The new images will be used the next time you start a new game.</source>
         <translation>Die neuen Bilder werden verwendet, wenn du das nächste Mal ein neues Spiel startest.</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="416"/>
-        <location filename="memory.cpp" line="424"/>
+        <location filename="memory.cpp" line="512"/>
+        <location filename="memory.cpp" line="520"/>
         <source>tie!</source>
         <translation>Unentschieden!</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="420"/>
+        <location filename="memory.cpp" line="516"/>
         <source>You win!</source>
         <translation>Du hast gewonnen!</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="428"/>
+        <location filename="memory.cpp" line="524"/>
         <source>Your score: </source>
         <translation>Deine Punktzahl: </translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="440"/>
+        <location filename="memory.cpp" line="536"/>
         <source>Previous high score: %1</source>
         <translation>Bisherige Höchstpunktzahl: %1</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="448"/>
+        <location filename="memory.cpp" line="544"/>
         <source>Found pairs</source>
         <translation>gefundene Paare</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="452"/>
-        <location filename="memory.cpp" line="517"/>
+        <location filename="memory.cpp" line="548"/>
+        <location filename="memory.cpp" line="614"/>
         <source>Mistakes</source>
         <translation>Fehler</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="456"/>
+        <location filename="memory.cpp" line="552"/>
         <source>Needed time</source>
         <oldsource>Needed&lt;br&gt;time</oldsource>
         <translation>benötigte Zeit</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="461"/>
+        <location filename="memory.cpp" line="557"/>
         <source>m &apos;min.&apos; s &apos;sec.&apos;</source>
         <translation>m &apos;Min.&apos; s &apos;Sek.&apos;</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="466"/>
+        <location filename="memory.cpp" line="562"/>
         <source>Score calculation:</source>
         <translation>Zusammenstellung der Punktzahl:</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="468"/>
+        <location filename="memory.cpp" line="564"/>
         <source>Number of&lt;br&gt;cards x 20</source>
         <translation>Anzahl Karten&lt;br&gt;x 20</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="472"/>
+        <location filename="memory.cpp" line="568"/>
         <source>less&lt;br&gt;seconds elapsed</source>
         <translation>abzügl.&lt;br&gt;abgelaufene&lt;br&gt;Sekunden</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="476"/>
+        <location filename="memory.cpp" line="572"/>
         <source>less&lt;br&gt;mistakes x 10</source>
         <translation>abzügl.&lt;br&gt;Fehler x 10</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="179"/>
-        <location filename="memory.cpp" line="496"/>
+        <location filename="memory.cpp" line="273"/>
+        <location filename="memory.cpp" line="593"/>
         <source>You</source>
         <translation>Du</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="71"/>
-        <location filename="memory.cpp" line="212"/>
+        <location filename="memory.cpp" line="171"/>
+        <location filename="memory.cpp" line="175"/>
         <source>No or not enough images were found in the folder %1.
 
 </source>
@@ -145,77 +145,107 @@
 </translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="72"/>
+        <location filename="memory.cpp" line="172"/>
         <source>In the following, you can select another folder with images.</source>
         <translation>Im Anschluss hast du die Möglichkeit, einen anderen Ordner mit Bildern zu wählen.</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="179"/>
+        <location filename="memory.cpp" line="273"/>
         <source>Computer</source>
         <translation>Rechner</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="422"/>
-        <location filename="memory.cpp" line="497"/>
+        <location filename="memory.cpp" line="518"/>
+        <location filename="memory.cpp" line="594"/>
         <source>The computer</source>
         <translation>Der Rechner</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="412"/>
-        <location filename="memory.cpp" line="414"/>
-        <location filename="memory.cpp" line="422"/>
+        <location filename="memory.cpp" line="508"/>
+        <location filename="memory.cpp" line="510"/>
+        <location filename="memory.cpp" line="518"/>
         <source>wins!</source>
         <translation>hat gewonnen!</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="177"/>
-        <location filename="memory.cpp" line="414"/>
-        <location filename="memory.cpp" line="501"/>
+        <location filename="memory.cpp" line="271"/>
+        <location filename="memory.cpp" line="510"/>
+        <location filename="memory.cpp" line="598"/>
         <source>Player 2</source>
         <translation>Spieler 2</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="459"/>
+        <location filename="memory.cpp" line="555"/>
         <source>h &apos;hrs.&apos; m &apos;min.&apos; s &apos;sec.&apos;</source>
         <oldsource>m&apos; Minuten, &apos;s&apos; Sekunden&apos;</oldsource>
         <translation>h &apos;Std.&apos; m &apos;Min.&apos; s &apos;Sek.&apos;</translation>
     </message>
     <message>
-        <location filename="memory.cpp" line="516"/>
+        <location filename="memory.cpp" line="613"/>
         <source>Found&lt;br&gt;pairs</source>
         <oldsource>found pairs: </oldsource>
         <translation>gefundene Paare</translation>
     </message>
+    <message>
+        <location filename="memory.cpp" line="80"/>
+        <source>&amp;Open image deck</source>
+        <translation>Bilder&amp;paket öffnen</translation>
+    </message>
+    <message>
+        <location filename="memory.cpp" line="85"/>
+        <source>Loader &amp;statistics</source>
+        <translation>Lade&amp;statistik</translation>
+    </message>
+    <message>
+        <location filename="memory.cpp" line="294"/>
+        <source>Select image deck</source>
+        <translation>Wähle Bilderpaket</translation>
+    </message>
+    <message>
+        <location filename="memory.cpp" line="295"/>
+        <source>Image decks (*.zip *.tar)</source>
+        <translation>Bilderpakete (*.zip *.tar)</translation>
+    </message>
+    <message>
+        <location filename="memory.cpp" line="308"/>
+        <source>Loader statistics</source>
+        <translation>Ladestatistik</translation>
+    </message>
+    <message>
+        <location filename="memory.cpp" line="309"/>
+        <source>Image loader statistics (%1):</source>
+        <translation>Statistik des Bilderladers (%1):</translation>
+    </message>
 </context>
 <context>
     <name>MemoryView</name>
     <message>
-        <location filename="memoryview.cpp" line="91"/>
+        <location filename="memoryview.cpp" line="116"/>
         <source>WARNING: Failed to open backside image file %1</source>
         <translation>WARNUNG: Konnte das Rückseiten-Bild nicht laden: %1</translation>
     </message>
     <message>
-        <location filename="memoryview.cpp" line="186"/>
+        <location filename="memoryview.cpp" line="261"/>
         <source>Error: set_images: not enough filenames specified</source>
         <translation>Fehler: set_images: nicht genügend Dateinamen angegeben</translation>
     </message>
     <message>
-        <location filename="memoryview.cpp" line="191"/>
+        <location filename="memoryview.cpp" line="266"/>
         <source>Error: set_images: number of cards is greater than available positions (num_pairs &gt; cols*rows)</source>
         <translation>Fehler: set_images: Anzahl Karten ist größer als verfügbare Positionen (num_pairs &gt; cols*rows)</translation>
     </message>
     <message>
-        <location filename="memoryview.cpp" line="313"/>
+        <location filename="memoryview.cpp" line="395"/>
         <source>pairs:</source>
         <translation>Paare:</translation>
     </message>
     <message>
-        <location filename="memoryview.cpp" line="314"/>
+        <location filename="memoryview.cpp" line="396"/>
         <source>mistakes:</source>
         <translation>Fehler:</translation>
     </message>
     <message>
-        <location filename="memoryview.cpp" line="376"/>
+        <location filename="memoryview.cpp" line="458"/>
         <source>Time:</source>
         <translation>Spielzeit:</translation>
     </message>
@@ -223,72 +253,72 @@
 <context>
     <name>NewGameDialog</name>
     <message>
-        <location filename="newgamedialog.cpp" line="25"/>
+        <location filename="newgamedialog.cpp" line="30"/>
         <source>&amp;Number of card pairs:</source>
         <translation>&amp;Anzahl Kartenpaare:</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="36"/>
+        <location filename="newgamedialog.cpp" line="41"/>
         <source>&amp;Single player game</source>
         <translation>&amp;Einzelspieler</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="37"/>
+        <location filename="newgamedialog.cpp" line="42"/>
         <source>&amp;Two player game</source>
         <translation>&amp;Zwei Spieler</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="38"/>
+        <location filename="newgamedialog.cpp" line="43"/>
         <source>Play against &amp;computer:</source>
         <translation>Spiel gegen den &amp;Computer:</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="45"/>
+        <location filename="newgamedialog.cpp" line="50"/>
         <source>Difficulty</source>
         <translation>Schwierigkeitsgrad</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="46"/>
+        <location filename="newgamedialog.cpp" line="51"/>
         <source>&amp;1: easy game</source>
         <translation>&amp;1: Einfach</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="47"/>
+        <location filename="newgamedialog.cpp" line="52"/>
         <source>&amp;2: normal game</source>
         <translation>&amp;2: Mittel</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="48"/>
+        <location filename="newgamedialog.cpp" line="53"/>
         <source>&amp;3: hard game</source>
         <translation>&amp;3: Schwierig</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="49"/>
+        <location filename="newgamedialog.cpp" line="54"/>
         <source>&amp;4: impossible game</source>
         <translation>&amp;4: Profi</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="64"/>
+        <location filename="newgamedialog.cpp" line="69"/>
         <source>Starting player</source>
         <translation>Wer beginnt?</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="65"/>
+        <location filename="newgamedialog.cpp" line="70"/>
         <source>&amp;human player starts</source>
         <translation>&amp;Du fängst an</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="66"/>
+        <location filename="newgamedialog.cpp" line="71"/>
         <source>com&amp;puter starts</source>
         <translation>Com&amp;puter fängt an</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="67"/>
+        <location filename="newgamedialog.cpp" line="72"/>
         <source>&amp;random player starts</source>
         <translation>Zufällige&amp;r Spieler beginnt</translation>
     </message>
     <message>
-        <location filename="newgamedialog.cpp" line="99"/>
+        <location filename="newgamedialog.cpp" line="104"/>
         <source>Start new game</source>
         <translation>Neues Spiel</translation>
     </message>
@@ -296,7 +326,7 @@
 <context>
     <name>Tile</name>
     <message>
-        <location filename="tile.cpp" line="108"/>
+        <location filename="tile.cpp" line="415"/>
         <source>Please
 wait...</source>
         <translation>Bitte
@@ -24,6 +24,16 @@
 
 #include "memoryview.h"
 
+// The loaded images are passed to the tiles in batches, at most this many in each frame. Each 
+// delivered image makes its tiles repaint, so a burst of images is spread over a few frames:
+#define MAX_IMAGES_PER_FRAME 4
+// used if the refresh rate of the display is not known:
+#define FRAME_INTERVAL_MS 16
+// The board is laid out again when the size of the view has not changed for this long:
+#define RESIZE_DELAY_MS 150
+// memory for the backside images and backgrounds kept for other sizes of the view:
+#define LAYOUT_CACHE_BYTES (64 * 1024 * 1024)
+
 
 // Return random uint between min and max (inclusive)
 // srand(uint seed) needs to be called before.
@@ -64,7 +74,7 @@ static void shuffle_array(uint* array, const uint length, const uint only_first
 
 MemoryView::MemoryView(const int bordersize, const QString backside_filename, 
                        const double zoom_factor, QWidget *parent) 
-: QGraphicsView(parent), _bordersize(bordersize), _zoom_factor(zoom_factor)
+: QGraphicsView(parent), _layout_cache(LAYOUT_CACHE_BYTES / 1024), _bordersize(bordersize), _zoom_factor(zoom_factor)
 {
     _cols = 0;
     _rows = 0;
@@ -73,7 +83,8 @@ MemoryView::MemoryView(const int bordersize, const QString backside_filename,
     _currently_revealed_tiles[1] = NULL;
     _num_clicked_tiles = 0;
     _tileImageHandler = NULL;
-    _imageLoaderThread = NULL;
+    _thumbnail_cache = NULL;
+    _image_index = NULL;
     _interaction_enabled = false;
     _hide_tiles_next_click = false;
     _remove_tiles_next_click = false;
@@ -82,10 +93,19 @@ MemoryView::MemoryView(const int bordersize, const QString backside_filename,
     _found_pairs = 0;
     _boundary_width = 0;
     _boundary_height = 0;
+    _tile_size = 0;
+    _hovered_tile = NULL;
     _elapsed_milliseconds = 0;
     
+    _animation_clock.start();
+    
     _the_scene = new QGraphicsScene(this);
+    // Zoomed and flipping tiles change their geometry in every frame, which would rebuild the 
+    // scene's BSP tree over and over. The view finds the tiles in their grid itself (see tileAt):
+    _the_scene->setItemIndexMethod(QGraphicsScene::NoIndex);
     this->setScene(_the_scene);
+    // the tiles do not accept hover events, so the scene would not turn this on:
+    viewport()->setMouseTracking(true);
     // The background color is set again in resize_images, but here for initializing:
     _the_scene->setBackgroundBrush(QBrush("#0d913b"));
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
@@ -110,6 +130,18 @@ MemoryView::MemoryView(const int bordersize, const QString backside_filename,
     _status_text_font_height = settings.value("status_text_height", 26).toInt();
     _score_text_font_height = settings.value("score_text_height", 18).toInt();
     settings.endGroup();
+    settings.beginGroup("ImageLoading");
+    // number of images decoded simultaneously (0: one per CPU core):
+    _num_decoder_threads = settings.value("decoder_threads", 0).toInt();
+    // memory for the decoded images of one game, the rest is decoded when needed (0: no limit):
+    _memory_budget_mb = settings.value("memory_budget_mb", 512).toLongLong();
+    // memory for the decoded images kept for the next games (0: none are kept):
+    qint64 image_cache_mb = settings.value("image_cache_mb", 256).toLongLong();
+    settings.endGroup();
+    // the loader threads and the cache are kept for all games:
+    _image_loader = new ImageLoader(this);
+    _image_loader->setMaxWorkers(_num_decoder_threads);
+    _image_loader->imageCache()->setMaxBytes(image_cache_mb * 1024 * 1024);
         
     _status_text_item = new QGraphicsSimpleTextItem();
     _status_text_item->hide();
@@ -121,24 +153,26 @@ MemoryView::MemoryView(const int bordersize, const QString backside_filename,
 MemoryView::~MemoryView()
 {
     clear();
+    // wait until the decoders using the cache have stopped:
+    delete _image_loader;
+    delete _thumbnail_cache;
     delete _status_text_item;
 }
 
 void MemoryView::clear()
 {
-    if (_imageLoaderThread && _imageLoaderThread->isRunning()) {
-        // ImageLoaderThread is still running from previous call to set_images. Stop it first:
-        _tileImageHandler->cancelLoading();
-        int time_out = 100;
-        while (_imageLoaderThread->isRunning() && time_out > 0) {
-            // process events, so the canceled tileImageHandler can emit finishedLoading which
-            // in turn stops the thread:
-            QCoreApplication::processEvents();
-            _imageLoaderThread->wait(100);
-            time_out--;
-        }
-        _imageLoaderThread->exit();
+    if (_tileImageHandler) {
+        // The handler is still there from the previous call to set_images. Once canceled, it does
+        // not touch the tiles anymore. It is deleted in the background when its decoders have 
+        // stopped, so there is no need to wait for them:
+        _image_loader->dispose(_tileImageHandler);
+        _tileImageHandler = NULL;
     }
+    // the images still waiting for delivery are dropped with the handler:
+    _delivery_timer.stop();
+    _animation_timer.stop();
+    _animated_tiles.clear();
+    _hovered_tile = NULL;
     
     for (uint i = 0; i < _cols; i++) {
         for (uint j = 0; j < _rows; j++)
@@ -150,11 +184,7 @@ void MemoryView::clear()
     }
     delete[] _tiles;
     _tiles = NULL;
-    // now that all tiles have been deleted, we can also delete the image handler:
-    delete _tileImageHandler;
-    _tileImageHandler = NULL;
-    delete _imageLoaderThread;
-    _imageLoaderThread = NULL;
+    _atlas.clear();
         
     // delete previous score items:
     for (int i = 0; i < _score_text_items.size(); ++i) {
@@ -182,11 +212,51 @@ void MemoryView::clear()
     _hide_tiles_next_click = false;
 }
 
+QVector<uint> MemoryView::drawCards(const uint num_pairs, const QStringList& filenames) const
+{
+    // Images the index knows to be broken are not used. Images not indexed yet are used anyway.
+    // (Not checking the files is much faster; a changed file is found by the update of the index.)
+    QVector<uint> usable_cards;
+    usable_cards.reserve(filenames.count());
+    for (int i = 0; i < filenames.count(); i++) {
+        ImageInfo info;
+        if (!_image_index || !_image_index->lookup(filenames.at(i), info, false) || info.valid)
+            usable_cards.append(i);
+    }
+    uint available_cards = usable_cards.count();
+    if (num_pairs > available_cards || available_cards == 0)
+        return QVector<uint>();
+    
+    // Make a list of available card indexes:
+    uint cardindexes[available_cards];
+    for (uint i = 0; i < available_cards; i++)
+        cardindexes[i] = usable_cards.at(i);
+    
+    // Then, shuffle it (only the first 'num_pairs' are of interest):
+    shuffle_array(cardindexes, available_cards, num_pairs);
+    // We will use the first num_pairs cards.
+    QVector<uint> cards(num_pairs);
+    for (uint i = 0; i < num_pairs; i++)
+        cards[i] = cardindexes[i];
+    return cards;
+}
+
 bool MemoryView::set_images(const uint num_pairs, const uint cols, const uint rows, const QStringList& filenames)
 {
     uint num_positions = num_pairs * 2;
-    uint available_cards = filenames.count();
-    if (num_pairs > available_cards || available_cards == 0) { 
+    // First, choose which cards to use. If the same images are used again with the same number 
+    // of pairs, the cards drawn in advance are taken, which have been loaded already:
+    QVector<uint> cards;
+    if (_next_cards.count() == (int)num_pairs && _next_filenames == filenames)
+        cards = _next_cards;
+    else {
+        // the prefetched images are not needed now
+        _image_loader->cancelPrefetch();
+        cards = drawCards(num_pairs, filenames);
+    }
+    _next_cards.clear();
+    _next_filenames.clear();
+    if (cards.isEmpty()) { 
         QMessageBox::warning(this, QCoreApplication::applicationName(),
                              tr("Error: set_images: not enough filenames specified"));
         return false;
@@ -204,6 +274,7 @@ bool MemoryView::set_images(const uint num_pairs, const uint cols, const uint ro
     // clear all previous tiles and arrays:  
     clear();
     _num_pairs = num_pairs;
+    _filenames = filenames;
     
     // show empty board during lenghty image loading time:
     // - not neccessary anymore, because image loading is done in different threads,
@@ -213,21 +284,11 @@ bool MemoryView::set_images(const uint num_pairs, const uint cols, const uint ro
     _cols = cols;
     _rows = rows;
     
-    // First, choose which cards to use.
-    // Make a list of available card indexes:
-    uint cardindexes[available_cards];
-    for (uint i = 0; i < available_cards; i++)
-        cardindexes[i] = i;
-    
-    // Then, shuffle it (only the first 'num_pairs' are of interest):
-    shuffle_array(cardindexes, available_cards, num_pairs);
-    // We will use the first num_pairs cards.
-    
     // initialize all final indexes to the first num_pairs cards, using each card twice:
     uint indexlist[num_positions];
     for (uint i = 0; i < num_pairs; i++) {
-        indexlist[2 * i] = cardindexes[i];
-        indexlist[2 * i + 1] = cardindexes[i];
+        indexlist[2 * i] = cards[i];
+        indexlist[2 * i + 1] = cards[i];
     }
     
     // Finally, shuffle this list:
@@ -236,6 +297,21 @@ bool MemoryView::set_images(const uint num_pairs, const uint cols, const uint ro
     // create the TileImageHandler, which will load and distribute the images to the tiles:
     // (can't have a parent, because it will later be moved to another thread)
     _tileImageHandler = new TileImageHandler(num_pairs, 2);
+    _tileImageHandler->setMemoryBudget(_memory_budget_mb * 1024 * 1024);
+    if (!_thumbnail_cache) {
+        // Create the cache on first use, when the application's settings are set up. 
+        // It is saved next to the INI file:
+        QSettings settings;
+        settings.beginGroup("ImageLoading");
+        qint64 max_megabytes = settings.value("thumbnail_cache_mb", 512).toLongLong();
+        settings.endGroup();
+        if (max_megabytes > 0)
+            _thumbnail_cache = new ThumbnailCache(
+                QFileInfo(settings.fileName()).absolutePath() + "/thumbnails", max_megabytes * 1024 * 1024);
+    }
+    _tileImageHandler->setThumbnailCache(_thumbnail_cache);
+    _tileImageHandler->setImageIndex(_image_index);
+    _tileImageHandler->setPackedDeck(&_packed_deck);
     
     // initialize tile matrix:
     _tiles = new Tile **[_cols];
@@ -252,10 +328,12 @@ bool MemoryView::set_images(const uint num_pairs, const uint cols, const uint ro
                 _tiles[i][j]->setSize(QSize(1, 1));
                 _tiles[i][j]->setPos(-10, -10);
                 // connect to private slots:
-                connect(_tiles[i][j], SIGNAL(tileClicked(Tile*)),
-                        this,  SLOT(tileClicked(Tile*)));
                 connect(_tiles[i][j], SIGNAL(tileFlipped(Tile*)),
                         this,  SLOT(tileFlipped(Tile*)));
+                connect(_tiles[i][j], SIGNAL(tileHovered(Tile*)),
+                        this,  SLOT(tileHovered(Tile*)));
+                connect(_tiles[i][j], SIGNAL(animationRequested(Tile*)),
+                        this,  SLOT(animateTile(Tile*)));
                 // add this tile to the image handler:
                 _tileImageHandler->addTile(indexlist[idx], filenames.at(indexlist[idx]), _tiles[i][j]);
                 
@@ -268,16 +346,15 @@ bool MemoryView::set_images(const uint num_pairs, const uint cols, const uint ro
     }    
     
     // set correct size and positions for all tiles:
-    resize_images();
+    relayout();
     
     // now, we can start loading the images
     // load them in a separate thread as not to block the GUI:
-    _imageLoaderThread = new QThread(this);
-    _tileImageHandler->moveToThread(_imageLoaderThread);
-    connect(_imageLoaderThread, SIGNAL(started()), _tileImageHandler, SLOT(startLoading()));
-    connect(_tileImageHandler, SIGNAL(finishedLoading(bool)), _imageLoaderThread, SLOT(quit()));
     connect(_tileImageHandler, SIGNAL(finishedLoading(bool)), this, SLOT(finishedLoading(bool)));
-    _imageLoaderThread->start();
+    connect(_tileImageHandler, SIGNAL(imagesReady()), this, SLOT(imagesReady()), Qt::QueuedConnection);
+    // The handler keeps running after all images have been loaded, because it 
+    // decodes them again if the tiles grow. It is disposed of in clear().
+    _image_loader->start(_tileImageHandler);
     
     // restore user interaction:
     enableUserInteraction(interact);
@@ -454,7 +531,9 @@ void MemoryView::revealTile(const uint column, const uint row)
         
         _num_clicked_tiles++;
         _num_moving_tiles++;
-        tile->flip();
+        // the image is needed as soon as the tile has turned over:
+        _tileImageHandler->prioritize(tile->get_id(), PRIORITY_REVEALED);
+        flipTile(tile);
     }
 }
 
@@ -466,7 +545,15 @@ void MemoryView::tileClicked(Tile *tile)
     
     _num_clicked_tiles++;
     _num_moving_tiles++;
-    tile->flip();
+    // the image is needed as soon as the tile has turned over:
+    _tileImageHandler->prioritize(tile->get_id(), PRIORITY_REVEALED);
+    flipTile(tile);
+}
+
+void MemoryView::tileHovered(Tile* tile)
+{
+    if (_tileImageHandler && tile->is_flipped())
+        _tileImageHandler->prioritize(tile->get_id(), PRIORITY_HOVERED);
 }
 
 void MemoryView::tileFlipped(Tile* tile)
@@ -512,8 +599,36 @@ void MemoryView::tileFlipped(Tile* tile)
 }
 
 void MemoryView::finishedLoading(bool success) {
-    if (success)
+    if (success) {
         emit imagesLoaded();
+        prefetchNextGame();
+    }
+}
+
+void MemoryView::imagesReady()
+{
+    if (!_tileImageHandler || _delivery_timer.isActive())
+        // a handler disposed of meanwhile, or the images are delivered in the next frame anyway
+        return;
+    // the first batch right away, the others in the following frames:
+    if (_tileImageHandler->deliverImages(MAX_IMAGES_PER_FRAME))
+        _delivery_timer.start(frameInterval(), this);
+}
+
+void MemoryView::prefetchNextGame()
+{
+    // The next game will probably use the same images and number of pairs. Draw its cards now, 
+    // while the loader has nothing else to do, and load their images in the background:
+    _next_cards = drawCards(_num_pairs, _filenames);
+    if (_next_cards.isEmpty())
+        return;
+    _next_filenames = _filenames;
+    QStringList files;
+    for (int i = 0; i < _next_cards.count(); i++)
+        files << _filenames.at(_next_cards.at(i));
+    // if the window size does not change, the next game has the same tile size:
+    _image_loader->prefetch(files, int(calc_tile_size(_cols, _rows)), _zoom_factor, 
+                            _thumbnail_cache, _image_index, &_packed_deck);
 }
 
 void MemoryView::hideTiles()
@@ -521,19 +636,69 @@ void MemoryView::hideTiles()
     if (_currently_revealed_tiles[0] && _currently_revealed_tiles[1]) {
         for (int i = 0; i < 2; ++i) {
             _num_moving_tiles++;
-            _currently_revealed_tiles[i]->flip();
+            flipTile(_currently_revealed_tiles[i]);
+            // the image is not needed anymore while the tile is face down:
+            QMetaObject::invokeMethod(_tileImageHandler, "unpin", Q_ARG(uint, _currently_revealed_tiles[i]->get_id()));
             _currently_revealed_tiles[i] = 0;
         }
         _num_clicked_tiles = 0;
     }
 }
 
+void MemoryView::flipTile(Tile* tile)
+{
+    tile->flip(_animation_clock.elapsed());
+    animateTile(tile);
+}
+
+void MemoryView::animateTile(Tile* tile)
+{
+    if (!_animated_tiles.contains(tile))
+        _animated_tiles.append(tile);
+    if (!_animation_timer.isActive())
+#if QT_VERSION >= 0x050000
+        _animation_timer.start(frameInterval(), Qt::PreciseTimer, this);
+#else
+        _animation_timer.start(frameInterval(), this);
+#endif
+}
+
+void MemoryView::animateTiles()
+{
+    qint64 now = _animation_clock.elapsed();
+    // A tile that finishes emits tileFlipped, which may start other tiles flipping, 
+    // so the list can grow during the loop. Tiles that only zoom are done after one call:
+    int i = 0;
+    while (i < _animated_tiles.size()) {
+        Tile *tile = _animated_tiles.at(i);
+        if (tile->animate(now))
+            i++;
+        else
+            _animated_tiles.removeOne(tile);
+    }
+    if (_animated_tiles.isEmpty())
+        _animation_timer.stop();
+}
+
+int MemoryView::frameInterval() const
+{
+#if QT_VERSION >= 0x050000
+    QWindow *window = this->window()->windowHandle();
+    QScreen *screen = window ? window->screen() : QGuiApplication::primaryScreen();
+    if (screen && screen->refreshRate() > 1)
+        return qMax(1, int(1000 / screen->refreshRate()));
+#endif
+    return FRAME_INTERVAL_MS;
+}
+
 void MemoryView::removePair()
 {
     if (_currently_revealed_tiles[0] && _currently_revealed_tiles[1] &&
         _currently_revealed_tiles[0]->get_id() == _currently_revealed_tiles[1]->get_id()) 
     {
         uint id = _currently_revealed_tiles[0]->get_id();
+        // the image of this pair is not needed anymore:
+        QMetaObject::invokeMethod(_tileImageHandler, "releaseImage", Q_ARG(uint, id));
     
         for (int i = 0; i < 2; ++i)
             _currently_revealed_tiles[i] = 0;
@@ -546,6 +711,8 @@ void MemoryView::removePair()
                     // Remove the tiles from the scene. This will not delete the Tile objects,
                     // but they might still be used somewhere. They will be deleted later with clear()
                     _the_scene->removeItem(_tiles[i][j]);
+                    if (_hovered_tile == _tiles[i][j])
+                        _hovered_tile = NULL;
                     num_found++;
                     if (num_found == 2) 
                         return;
@@ -555,7 +722,11 @@ void MemoryView::removePair()
 
 void MemoryView::mousePressEvent(QMouseEvent* event)
 {
-    QGraphicsView::mousePressEvent(event);
+    if (event->button() == Qt::LeftButton) {
+        Tile *tile = tileAt(mapToScene(event->pos()));
+        if (tile && !tile->is_flipping())
+            tileClicked(tile);
+    }
     if (_hide_tiles_next_click) {
         _hide_tiles_next_click = false;
         hideTiles();
@@ -570,9 +741,50 @@ void MemoryView::mousePressEvent(QMouseEvent* event)
     }
 }
 
+void MemoryView::mouseMoveEvent(QMouseEvent* event)
+{
+    QGraphicsView::mouseMoveEvent(event);
+    QPointF pos = mapToScene(event->pos());
+    Tile *tile = tileAt(pos);
+    if (tile != _hovered_tile) {
+        if (_hovered_tile)
+            _hovered_tile->mouseLeft();
+        _hovered_tile = tile;
+        if (tile)
+            tile->mouseEntered();
+    }
+    if (tile)
+        tile->mouseMoved(tile->mapFromScene(pos));
+}
+
+void MemoryView::leaveEvent(QEvent* event)
+{
+    QGraphicsView::leaveEvent(event);
+    if (_hovered_tile)
+        _hovered_tile->mouseLeft();
+    _hovered_tile = NULL;
+}
+
 void MemoryView::resizeEvent(QResizeEvent *event)
 {
     QGraphicsView::resizeEvent(event);
+    if (!_tiles || _layout_size.isEmpty()) {
+        // nothing to preview yet
+        relayout();
+        return;
+    }
+    // Laying out the board is too slow to do it for every size while the window is dragged. 
+    // Until the size stays the same for a moment, the board is just scaled to fit the view:
+    double scale = fmin(width() / double(_layout_size.width()), height() / double(_layout_size.height()));
+    setTransform(QTransform::fromScale(scale, scale));
+    _resize_timer.start(RESIZE_DELAY_MS, this);
+}
+
+void MemoryView::relayout()
+{
+    _resize_timer.stop();
+    resetTransform();
+    _layout_size = size();
     // Why is this->size() 6 pixels wider and higher than event->size() on my computer?
     // Since I need this->size() elsewhere where I don't have access to event->size(), I just stick to this->size():
     setSceneRect(0, 0, width() - 8, height() - 8);
@@ -591,11 +803,44 @@ void MemoryView::timerEvent(QTimerEvent* event)
             item->setText(time.toString("hh:mm:ss")); 
         else
             item->setText(time.toString("mm:ss")); 
+    } else if (event->timerId() == _delivery_timer.timerId()) {
+        if (!_tileImageHandler || !_tileImageHandler->deliverImages(MAX_IMAGES_PER_FRAME))
+            // all delivered, imagesReady starts the timer again for the next ones
+            _delivery_timer.stop();
+    } else if (event->timerId() == _animation_timer.timerId()) {
+        animateTiles();
+    } else if (event->timerId() == _resize_timer.timerId()) {
+        relayout();
     } else {
         QObject::timerEvent(event);
     }
 }
 
+void MemoryView::drawBackground(QPainter* painter, const QRectF& rect)
+{
+    QGraphicsView::drawBackground(painter, rect);
+    if (!_tiles || !_atlas.isValid())
+        return;
+    // Instead of painting each tile at rest with its own call of Tile::paint, they are 
+    // all drawn here from the atlas at once:
+    QVector<QPainter::PixmapFragment> fragments;
+    double w = _atlas.tileSize().width(), h = _atlas.tileSize().height();
+    for (uint i = 0; i < _cols; i++) {
+        for (uint j = 0; j < _rows; j++) {
+            Tile *tile = _tiles[i][j];
+            if (!tile || !tile->is_batched() || !tile->scene())
+                continue;
+            QPointF pos = tile->pos();
+            if (!rect.intersects(QRectF(pos.x() - 0.5 * w, pos.y() - 0.5 * h, w, h)))
+                continue;
+            fragments << QPainter::PixmapFragment::create(
+                pos, tile->is_flipped() ? _atlas.backsideRect() : _atlas.faceRect(tile->get_id()));
+        }
+    }
+    if (!fragments.isEmpty())
+        painter->drawPixmapFragments(fragments.constData(), fragments.count(), _atlas.pixmap());
+}
+
 double MemoryView::calc_tile_size(const uint cols, const uint rows) {
     double tilewidth, tileheight;
     int width = size().width() - 8; // substract border
@@ -658,12 +903,23 @@ void MemoryView::resize_images()
         return;
     
     double tilesize = calc_tile_size(_cols, _rows);
+    _tile_size = tilesize;
     // calculate offset so the tiles are centered horizontally:
     double x_offset = (size().width() - 8 + _bordersize - _cols*(tilesize + _bordersize)) / 2.0;
     _boundary_width = x_offset;
     _boundary_height = 0.5 * tilesize * (_zoom_factor - 1);
     
     prepareBacksideImage(QSize(tilesize, tilesize));
+    // the frames of the old size are not needed anymore:
+    _face_cache.clear();
+    // the tiles add their faces again when needed:
+    _atlas.reset(QSize(tilesize, tilesize), _num_pairs, _backside_image);
+    
+    // Images are decoded just big enough for the current tile size. If the handler already
+    // lives in the loader thread, this is queued and executed there:
+    if (_tileImageHandler)
+        QMetaObject::invokeMethod(_tileImageHandler, "setTileSize", 
+                                  Q_ARG(int, int(tilesize)), Q_ARG(double, _zoom_factor));
     
     for (uint i = 0; i < _cols; i++) {
         for (uint j = 0; j < _rows; j++)
@@ -671,6 +927,8 @@ void MemoryView::resize_images()
             if (_tiles[i][j]) {
                 _tiles[i][j]->setSize(QSize(tilesize, tilesize));
                 _tiles[i][j]->setBacksideImage(&_backside_image);
+                _tiles[i][j]->setFaceCache(&_face_cache);
+                _tiles[i][j]->setAtlas(&_atlas);
             
                 // set tile's central position:
                 _tiles[i][j]->setPos(i * (tilesize + _bordersize) + _boundary_width + 0.5 * tilesize, 
@@ -679,22 +937,48 @@ void MemoryView::resize_images()
         }
     }
     
+    // The gradient is rendered once for the size and then just copied to the exposed areas:
+    QString key = QString("background %1x%2").arg(width()).arg(height());
+    QImage *cached = _layout_cache.object(key);
+    QImage background = cached ? *cached : renderBackground(size());
+    if (!cached)
+        // the cost is in kB (an image bigger than the whole cache is not kept):
+        _layout_cache.insert(key, new QImage(background), background.byteCount() / 1024 + 1);
+    this->setBackgroundBrush(QBrush(background));
+    // the tiles drawn from the atlas have moved, too:
+    _the_scene->update();
+    
+    calc_status_text_size();
+}
+
+QImage MemoryView::renderBackground(const QSize& size) const
+{
+    QImage image(size, QImage::Format_RGB32);
+    QPainter painter(&image);
+    
     //QRadialGradient gradient(QPointF(0, 0), this->width());
     //gradient.setColorAt(1, "#0d913b");
     //gradient.setColorAt(0, QColor::fromRgbF(0, 0, 0, 1));
     
-    QRadialGradient gradient(QPointF(width() / 2.0, height() / 2.0), fmax(width(), height()));
+    QRadialGradient gradient(QPointF(size.width() / 2.0, size.height() / 2.0), 
+                             fmax(size.width(), size.height()));
     //gradient.setColorAt(1, "#043214");
     gradient.setColorAt(1, "black");
     gradient.setColorAt(0, "#0d913b");
-    
-    this->setBackgroundBrush(QBrush(gradient));
-    
-    calc_status_text_size();
+    painter.fillRect(image.rect(), gradient);
+    return image;
 }
 
 void MemoryView::prepareBacksideImage(QSize tilesize)
 {
+    QString key = QString("backside %1x%2").arg(tilesize.width()).arg(tilesize.height());
+    QImage *cached = _layout_cache.object(key);
+    if (cached) {
+        // the tiles keep pointing to _backside_image:
+        _backside_image = *cached;
+        return;
+    }
+    
     _backside_image = QImage(tilesize.width(), tilesize.height(), 
                             QImage::Format_ARGB32_Premultiplied);
     
@@ -719,6 +1003,37 @@ void MemoryView::prepareBacksideImage(QSize tilesize)
     painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
     painter.setBrush(Qt::NoBrush);
     painter.drawRoundedRect(r, _bordersize, _bordersize);
+    painter.end();
+    _layout_cache.insert(key, new QImage(_backside_image), _backside_image.byteCount() / 1024 + 1);
+}
+
+Tile* MemoryView::tileAt(const QPointF& pos) const
+{
+    if (!_tiles || _tile_size <= 0)
+        return NULL;
+    // the cell of a tile goes halfway into the gaps next to it:
+    double pitch = _tile_size + _bordersize;
+    int col = int(floor((pos.x() - _boundary_width + 0.5 * _bordersize) / pitch));
+    int row = int(floor((pos.y() - _boundary_height + 0.5 * _bordersize) / pitch));
+    // how many cells a tile zoomed by zoom_factor reaches into its neighbors:
+    int reach = qMax(1, int(ceil(0.5 * (_zoom_factor - 1))));
+    
+    Tile *found = NULL;
+    for (int i = col - reach; i <= col + reach; i++) {
+        for (int j = row - reach; j <= row + reach; j++) {
+            if (i < 0 || j < 0 || i >= int(_cols) || j >= int(_rows))
+                continue;
+            Tile *tile = _tiles[i][j];
+            // (removed pairs are not in the scene anymore)
+            if (!tile || !tile->scene() || !tile->sceneBoundingRect().contains(pos))
+                continue;
+            // the own cell wins over neighbors reaching into it, unless they are zoomed (on top):
+            if (!found || tile->zValue() > found->zValue() || 
+                (tile->zValue() == found->zValue() && i == col && j == row))
+                found = tile;
+        }
+    }
+    return found;
 }
 
 void MemoryView::calc_status_text_size()
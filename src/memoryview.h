@@ -32,7 +32,14 @@
 #include <QTextStream>
 #include <QStringBuilder>
 #include <QTime>
+#include <QElapsedTimer>
+#include <QCache>
 #include <QMessageBox>
+#if QT_VERSION >= 0x050000
+#include <QGuiApplication>
+#include <QScreen>
+#include <QWindow>
+#endif
 #include "tileimagehandler.h"
 
 // Return random uint between min and max (inclusive)
@@ -58,6 +65,16 @@ public:
     // and all files could be loaded; otherwise returns false.
     bool set_images(const uint num_pairs, const uint cols, const uint rows, const QStringList &filenames);
     
+    // If an image index is set, images known to be broken are never used, and the tiles' border
+    // colors are taken from the index. The view does not take ownership.
+    void setImageIndex(const ImageIndex *index) { _image_index = index; };
+    // If a deck is opened here, the images packed into it are used without decoding them 
+    // (see PackedDeck):
+    PackedDeck *packedDeck() { return &_packed_deck; };
+    
+    // The time spent loading the images of all games so far (see LoaderStatistics):
+    LoaderStatistics *loaderStatistics() { return _image_loader->statistics(); };
+    
     // User interaction (cards flipped when clicked on) must be activated before:
     // This can be deactivated e.g. during A.I. opponent's move.
     void enableUserInteraction(const bool enabled = true);
@@ -100,13 +117,19 @@ public slots:
     void revealTile(const uint column, const uint row);
     
 private slots:
-    // The following two slots should be connected to the tiles.
-    // This one will flip tiles, but only if less than two are turned over:
+    // The following slots should be connected to the tiles, except tileClicked, which is called
+    // by mousePressEvent. This one will flip tiles, but only if less than two are turned over:
     void tileClicked(Tile *tile);
     // This will check for a match after two tiles have been revealed:
     void tileFlipped(Tile *tile);
+    // The image of a hovered tile will be needed soon, so it is loaded first:
+    void tileHovered(Tile *tile);
+    // Animates tile in the next frame, together with all other tiles that are moving:
+    void animateTile(Tile *tile);
     // If _tileImageHandler finished loading, connect to this:
     void finishedLoading(bool success);
+    // _tileImageHandler has images for the tiles, they are delivered in the next frames:
+    void imagesReady();
     
 signals: 
     void matchFound();
@@ -126,18 +149,47 @@ signals:
     
 protected:
     virtual void mousePressEvent(QMouseEvent *event);
+    virtual void mouseMoveEvent(QMouseEvent *event);
+    virtual void leaveEvent(QEvent *event);
     virtual void resizeEvent(QResizeEvent *event);
     virtual void timerEvent(QTimerEvent *event);
+    // Draws the background and all tiles at rest from the atlas (see TileAtlas):
+    virtual void drawBackground(QPainter *painter, const QRectF &rect);
     
 private:
+    // Returns the indexes (in filenames) of num_pairs different images chosen randomly, leaving out
+    // images the index knows to be broken. Returns no cards if there are not enough images.
+    QVector<uint> drawCards(const uint num_pairs, const QStringList &filenames) const;
+    // Draws the cards for the next game and loads their images in the background:
+    void prefetchNextGame();
+    
     // Calculate tile size such that cols columns and rows rows fit in view's current size:
     double calc_tile_size(const uint cols, const uint rows);
     
     // resize all tile images so they fit within view's current size
     void resize_images();
+    // Lays the board out for the current size of the view, ending a preview (see resizeEvent):
+    void relayout();
+    // Renders the background of the view for size, a radial gradient from green to black:
+    QImage renderBackground(const QSize &size) const;
+    
+    // Returns the tile at pos (in scene coordinates), or NULL if there is none. The tiles are looked
+    // up in the grid they are laid out in: only the cell at pos and the neighboring cells, into 
+    // which a zoomed tile can reach, are checked. Zoomed (hovered) tiles are on top of the others.
+    // Clicks and mouse movements are dispatched to the tiles this way instead of by the scene, 
+    // which does not keep an index of its items; the tiles change their geometry all the time.
+    Tile *tileAt(const QPointF &pos) const;
     
     void prepareBacksideImage(QSize tilesize);
     
+    // Starts turning tile over; it is animated with all other flipping tiles in animateTiles:
+    void flipTile(Tile *tile);
+    // Moves all flipping and zooming tiles on to the current time, called in each frame while
+    // there are some:
+    void animateTiles();
+    // Interval of the frames of the animations, matching the refresh rate of the display:
+    int frameInterval() const;
+    
     // only hides tiles if 2 tiles have been revealed:
     void hideTiles();
     // only removes pair if both cards are currently revealed:
@@ -147,8 +199,32 @@ private:
     
     QGraphicsScene *_the_scene;
     QImage _backside_image, _raw_backside_image;
-    QThread *_imageLoaderThread;
+    // the frames of the tile faces, for the current tile size:
+    TileFaceCache _face_cache;
+    // backside and faces of the tiles at rest, drawn in one go in drawBackground:
+    TileAtlas _atlas;
+    // backside images (with the tile size as key) and backgrounds (with the view size as key) 
+    // of the last sizes, so they are not rendered again when switching e.g. to full screen and back.
+    // The cost of an image is its size in kB:
+    QCache<QString, QImage> _layout_cache;
+    // the size of the view the board was laid out for last (see relayout):
+    QSize _layout_size;
+    // While the view is being resized, the board is only laid out again when the size has not 
+    // changed for a moment; in between, the old layout is shown scaled to the new size:
+    QBasicTimer _resize_timer;
+    ImageLoader *_image_loader;
     TileImageHandler *_tileImageHandler;
+    int _num_decoder_threads;
+    qint64 _memory_budget_mb;
+    // scaled images of previous games, shared by all TileImageHandlers (NULL if disabled):
+    ThumbnailCache *_thumbnail_cache;
+    const ImageIndex *_image_index;
+    PackedDeck _packed_deck;
+    // the images of the current game:
+    QStringList _filenames;
+    // cards drawn for the next game, if it uses the images _next_filenames (see prefetchNextGame):
+    QVector<uint> _next_cards;
+    QStringList _next_filenames;
     
     QGraphicsSimpleTextItem * _status_text_item;
     QFont _status_text_font;
@@ -165,12 +241,22 @@ private:
     
     QGraphicsSimpleTextItem* _timer_text_item;
     QBasicTimer _timer;
+    // while running, the loaded images are passed to the tiles in each frame:
+    QBasicTimer _delivery_timer;
+    // Runs while tiles are flipping or zooming, one tick per displayed frame. The state of the animations is 
+    // computed from animation_clock, so they keep their speed even if frames are dropped:
+    QBasicTimer _animation_timer;
+    QElapsedTimer _animation_clock;
+    QList<Tile*> _animated_tiles;
     QTime _timing;
     uint _elapsed_milliseconds; 
     
     bool _interaction_enabled;
     int _bordersize;
     double _boundary_width, _boundary_height;
+    double _tile_size;
+    // the tile under the mouse (see tileAt):
+    Tile *_hovered_tile;
     double _zoom_factor;
     
     Tile ***_tiles;   
@@ -107,6 +107,7 @@ NewGameDialog::NewGameDialog(const int max_pairs, QWidget* parent): QDialog(pare
     connect(_dialogButtonBox, SIGNAL(rejected()), this, SLOT(rejectValues()));
     connect(rb_computer_opponent, SIGNAL(toggled(bool)), groupBox1, SLOT(setEnabled(bool)));
     connect(rb_computer_opponent, SIGNAL(toggled(bool)), groupBox2, SLOT(setEnabled(bool)));
+    connect(_sb_number_of_pairs, SIGNAL(valueChanged(int)), this, SLOT(numberOfPairsChanged()));
     
     // read init values from INI file:
     QSettings settings;
@@ -117,6 +118,9 @@ NewGameDialog::NewGameDialog(const int max_pairs, QWidget* parent): QDialog(pare
     int starting_player = settings.value("starting_player", HUMAN_STARTS).toInt();
     settings.endGroup();
     
+    _preferred_number_of_pairs = numpairs;
+    _number_of_pairs_edited = false;
+    _setting_max_pairs = false;
     _number_of_pairs = max_pairs >= numpairs ? numpairs : max_pairs;
     _computer_opponent = opponent == COMPUTER_OPPONENT;
     _opponent = (OPPONENT)opponent;
@@ -131,12 +135,30 @@ NewGameDialog::NewGameDialog(const int max_pairs, QWidget* parent): QDialog(pare
 }
 
 void NewGameDialog::setMaxPairs(int maxPairs) {
-    _sb_number_of_pairs->setMaximum(maxPairs);
+    _setting_max_pairs = true;
+    // (the minimum would stay lowered if the maximum was below 2 before)
+    _sb_number_of_pairs->setRange(qMin(2, maxPairs), maxPairs);
+    // The maximum grows while the image folder is scanned, even while the dialog is open (a game
+    // is asked for as soon as there are 2 images). Don't change the value the user has chosen:
+    if (!isVisible())
+        // the user's change was for the last time the dialog was open:
+        _number_of_pairs_edited = false;
+    if (!_number_of_pairs_edited) {
+        _number_of_pairs = qMin(_preferred_number_of_pairs, maxPairs);
+        _sb_number_of_pairs->setValue(_number_of_pairs);
+    }
+    _setting_max_pairs = false;
+}
+
+void NewGameDialog::numberOfPairsChanged()
+{
+    if (!_setting_max_pairs && isVisible())
+        _number_of_pairs_edited = true;
 }
 
 void NewGameDialog::acceptValues()
 {
-    _number_of_pairs = _sb_number_of_pairs->value();
+    _preferred_number_of_pairs = _number_of_pairs = _sb_number_of_pairs->value();
     _opponent = (OPPONENT)_buttonGroup_opponent->checkedId();
     _difficulty_level = _buttonGroup_difficulty->checkedId();
     _starting_player = (STARTING_PLAYER)_buttonGroup_start->checkedId();
@@ -55,6 +55,8 @@ class NewGameDialog : public QDialog
 public:  
     NewGameDialog(const int max_pairs, QWidget *parent = 0);
     
+    // The number of pairs follows the maximum up to the number last chosen by the user, 
+    // unless the user has changed it in the open dialog:
     void setMaxPairs(int maxPairs);
 
     int getNumberOfPairs() const { return _number_of_pairs; };
@@ -65,6 +67,7 @@ public:
 private slots:
     void acceptValues();
     void rejectValues();
+    void numberOfPairsChanged();
     
 private:
     QSpinBox *_sb_number_of_pairs;
@@ -74,6 +77,12 @@ private:
     QDialogButtonBox *_dialogButtonBox;
     
     int _number_of_pairs;
+    // last number of pairs chosen by the user:
+    int _preferred_number_of_pairs;
+    // whether the user has changed the number of pairs in the open dialog:
+    bool _number_of_pairs_edited;
+    // true while setMaxPairs changes the number of pairs:
+    bool _setting_max_pairs;
     bool _computer_opponent;
     OPPONENT _opponent;
     STARTING_PLAYER _starting_player;
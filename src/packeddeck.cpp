@@ -0,0 +1,251 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "packeddeck.h"
+
+#define PACKED_DECK_MAGIC 0x4b43444d // "MDCK"
+// (version 2: a border color per level)
+#define PACKED_DECK_VERSION 2
+// The pixel data of each level starts at a multiple of this:
+#define PACKED_DECK_ALIGNMENT 64
+
+// The deck file starts with this header, followed by the image records, the level records, the 
+// names (UTF-8) and finally the pixel data of all levels:
+struct deck_header_t {
+    quint32 magic;
+    quint32 version;
+    quint32 num_images;
+    quint32 num_levels;
+    quint64 names_offset;
+    quint64 file_size;
+};
+
+struct deck_image_t {
+    quint32 name_offset; // relative to names_offset
+    quint32 name_length;
+    qint64 file_size;
+    qint32 width, height; // of the original image
+    quint32 first_level; // index of the first level record of this image
+    quint32 num_levels; // sorted by size, smallest first
+    quint32 reserved[2];
+};
+
+struct deck_level_t {
+    quint64 offset; // of the pixel data
+    qint32 width, height, bytes_per_line;
+    qint32 tilesize;
+    double max_zoom;
+    QRgb bordercolor;
+    quint32 reserved;
+};
+
+
+PackedDeck::PackedDeck() : _mapping(NULL)
+{
+}
+
+PackedDeck::~PackedDeck()
+{
+    close();
+}
+
+void PackedDeck::releaseMapping(void* mapping)
+{
+    Mapping *m = static_cast<Mapping*>(mapping);
+    if (!m->refs.deref())
+        // closing the file unmaps the memory
+        delete m;
+}
+
+QString PackedDeck::relativeName(const QString& filename)
+{
+    return filename.startsWith("img:") ? filename.mid(4) : filename;
+}
+
+bool PackedDeck::open(const QString& filename)
+{
+    close();
+    Mapping *m = new Mapping;
+    m->file.setFileName(filename);
+    m->data = NULL;
+    m->refs.storeRelease(1);
+    if (m->file.open(QIODevice::ReadOnly) && m->file.size() >= (qint64)sizeof(deck_header_t))
+        m->data = m->file.map(0, m->file.size());
+    if (!m->data) {
+        delete m;
+        return false;
+    }
+    
+    // check the whole index before using it:
+    const deck_header_t *header = reinterpret_cast<const deck_header_t*>(m->data);
+    qint64 size = m->file.size();
+    qint64 records_end = sizeof(deck_header_t) + (qint64)header->num_images * sizeof(deck_image_t) + 
+                         (qint64)header->num_levels * sizeof(deck_level_t);
+    bool valid = header->magic == PACKED_DECK_MAGIC && header->version == PACKED_DECK_VERSION &&
+                 header->file_size == (quint64)size && records_end <= (qint64)header->names_offset &&
+                 (qint64)header->names_offset <= size;
+    const deck_image_t *images = reinterpret_cast<const deck_image_t*>(m->data + sizeof(deck_header_t));
+    const deck_level_t *levels = reinterpret_cast<const deck_level_t*>(images + (valid ? header->num_images : 0));
+    QHash<QString, int> names;
+    for (quint32 i = 0; valid && i < header->num_images; ++i) {
+        const deck_image_t &image = images[i];
+        valid = header->names_offset + image.name_offset + image.name_length <= (quint64)size &&
+                (quint64)image.first_level + image.num_levels <= header->num_levels;
+        for (quint32 j = 0; valid && j < image.num_levels; ++j) {
+            const deck_level_t &level = levels[image.first_level + j];
+            valid = level.offset % PACKED_DECK_ALIGNMENT == 0 && level.width > 0 && level.height > 0 &&
+                    level.bytes_per_line >= 4 * level.width &&
+                    level.offset + (quint64)level.bytes_per_line * level.height <= (quint64)size;
+        }
+        if (valid)
+            names.insert(QString::fromUtf8(reinterpret_cast<const char*>(m->data + header->names_offset + image.name_offset), 
+                                           image.name_length), i);
+    }
+    if (!valid) {
+        printf("WARNING: Ignoring invalid image deck %s\n", filename.toStdString().c_str());
+        delete m;
+        return false;
+    }
+    
+    QWriteLocker locker(&_lock);
+    _mapping = m;
+    _names = names;
+    return true;
+}
+
+void PackedDeck::close()
+{
+    QWriteLocker locker(&_lock);
+    if (_mapping)
+        // the images still referencing it keep it mapped
+        releaseMapping(_mapping);
+    _mapping = NULL;
+    _names.clear();
+}
+
+bool PackedDeck::isOpen() const
+{
+    QReadLocker locker(&_lock);
+    return _mapping != NULL;
+}
+
+QImage PackedDeck::find(const QString& filename, const int tilesize, const double max_zoom, QColor& bordercolor) const
+{
+    QReadLocker locker(&_lock);
+    if (!_mapping)
+        return QImage();
+    QHash<QString, int>::const_iterator it = _names.find(relativeName(filename));
+    if (it == _names.end())
+        return QImage();
+    const deck_header_t *header = reinterpret_cast<const deck_header_t*>(_mapping->data);
+    const deck_image_t *images = reinterpret_cast<const deck_image_t*>(_mapping->data + sizeof(deck_header_t));
+    const deck_level_t *levels = reinterpret_cast<const deck_level_t*>(images + header->num_images);
+    const deck_image_t &image = images[it.value()];
+    
+    QString path;
+    qint64 mtime, size;
+    if (!image_file_info(filename, path, mtime, size) || size != image.file_size)
+        // changed since the deck was packed
+        return QImage();
+    for (quint32 j = 0; j < image.num_levels; ++j) {
+        const deck_level_t &level = levels[image.first_level + j];
+        if (level.tilesize < tilesize || level.max_zoom < max_zoom)
+            continue;
+        bordercolor = QColor(level.bordercolor);
+        // The image references the mapped memory, which stays valid until the last copy of the
+        // image is deleted:
+        _mapping->refs.ref();
+        return QImage(_mapping->data + level.offset, level.width, level.height, level.bytes_per_line,
+                      QImage::Format_ARGB32_Premultiplied, releaseMapping, _mapping);
+    }
+    // only smaller versions
+    return QImage();
+}
+
+bool PackedDeck::write(const QString& filename, const QList<Image>& images)
+{
+    // the records and names first, to know where the pixel data starts:
+    deck_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = PACKED_DECK_MAGIC;
+    header.version = PACKED_DECK_VERSION;
+    header.num_images = images.count();
+    QVector<deck_image_t> image_records(images.count());
+    QVector<deck_level_t> level_records;
+    QByteArray names;
+    for (int i = 0; i < images.count(); ++i) {
+        const Image &image = images.at(i);
+        deck_image_t &record = image_records[i];
+        memset(&record, 0, sizeof(record));
+        QByteArray name = image.name.toUtf8();
+        record.name_offset = names.size();
+        record.name_length = name.size();
+        names += name;
+        record.file_size = image.file_size;
+        record.width = image.original_size.width();
+        record.height = image.original_size.height();
+        record.first_level = level_records.count();
+        record.num_levels = image.levels.count();
+        for (int j = 0; j < image.levels.count(); ++j) {
+            deck_level_t level;
+            memset(&level, 0, sizeof(level));
+            level.width = image.levels.at(j).width();
+            level.height = image.levels.at(j).height();
+            // (in QImage::Format_ARGB32_Premultiplied, there is no padding)
+            level.bytes_per_line = 4 * level.width;
+            level.tilesize = image.tilesizes.at(j);
+            level.max_zoom = image.max_zoom;
+            level.bordercolor = image.bordercolors.at(j).rgb();
+            level_records << level;
+        }
+    }
+    header.num_levels = level_records.count();
+    header.names_offset = sizeof(header) + image_records.count() * sizeof(deck_image_t) + 
+                          level_records.count() * sizeof(deck_level_t);
+    quint64 offset = header.names_offset + names.size();
+    for (int i = 0; i < level_records.count(); ++i) {
+        offset = (offset + PACKED_DECK_ALIGNMENT - 1) / PACKED_DECK_ALIGNMENT * PACKED_DECK_ALIGNMENT;
+        level_records[i].offset = offset;
+        offset += (quint64)level_records[i].bytes_per_line * level_records[i].height;
+    }
+    header.file_size = offset;
+    
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(image_records.constData()), image_records.count() * sizeof(deck_image_t));
+    file.write(reinterpret_cast<const char*>(level_records.constData()), level_records.count() * sizeof(deck_level_t));
+    file.write(names);
+    int n = 0;
+    for (int i = 0; i < images.count(); ++i)
+        for (int j = 0; j < images.at(i).levels.count(); ++j, ++n) {
+            QImage pixels = images.at(i).levels.at(j).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+            // padding up to the aligned offset:
+            file.write(QByteArray(level_records[n].offset - file.pos(), '\0'));
+            file.write(reinterpret_cast<const char*>(pixels.constBits()), 
+                       (qint64)level_records[n].bytes_per_line * level_records[n].height);
+        }
+    return file.commit();
+}
@@ -0,0 +1,101 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PACKEDDECK_H
+#define PACKEDDECK_H
+
+#include <QImage>
+#include <QColor>
+#include <QFile>
+#include <QSaveFile>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QReadWriteLock>
+#include <QAtomicInt>
+#include <stdio.h> // for printf()
+#include <string.h> // for memset()
+#include "imagearchive.h"
+
+// A precompiled image deck: a single file with the images of a folder (or image archive), already
+// decoded for several tile sizes and converted to QImage::Format_ARGB32_Premultiplied, 
+// together with their border colors. It is written by the deckpacker tool and saved next to the 
+// folder (see fileName). The game maps it into memory and wraps its pixels in QImages without 
+// copying them, so the tiles of a packed folder get their images at once, even on the first start.
+// All public methods are thread-safe.
+class PackedDeck
+{
+public:
+    // An image to be written to a deck (see write):
+    struct Image {
+        QString name; // relative to the folder
+        qint64 file_size; // of the image file, to recognize changed files
+        QSize original_size;
+        // the versions of the image, each for tiles of size tilesizes[i] zoomed by max_zoom,
+        // and the border colors found on them:
+        QList<QImage> levels;
+        QList<int> tilesizes;
+        QList<QColor> bordercolors;
+        double max_zoom;
+    };
+    
+    PackedDeck();
+    ~PackedDeck();
+    
+    // The deck of the images in folder (or image archive) path:
+    static QString fileName(const QString &path) { return path + ".deck"; };
+    
+    // Opens deck file filename, closing the previous one. Returns false if it does not exist 
+    // or is invalid, then the deck is empty. Images returned by find stay valid.
+    bool open(const QString &filename);
+    void close();
+    bool isOpen() const;
+    
+    // Returns the smallest version of image filename stored for tiles of at least size tilesize
+    // and max_zoom, if its file has not changed since the deck was written. Otherwise, a null 
+    // image is returned. On success, bordercolor is set. The returned image references the mapped
+    // file and must not be modified (it would be copied).
+    QImage find(const QString &filename, const int tilesize, const double max_zoom, QColor &bordercolor) const;
+    
+    // Writes images to deck file filename. Returns false on failure.
+    static bool write(const QString &filename, const QList<Image> &images);
+    
+private:
+    // The mapped deck file, freed after it is closed and the last image referencing it is deleted:
+    struct Mapping {
+        QFile file;
+        const uchar *data;
+        QAtomicInt refs;
+    };
+    static void releaseMapping(void *mapping);
+    
+    // Returns the name of filename in the deck:
+    static QString relativeName(const QString &filename);
+    
+    Mapping *_mapping;
+    QHash<QString, int> _names; // index of each image in the deck
+    mutable QReadWriteLock _lock;
+};
+
+#endif // PACKEDDECK_H
@@ -0,0 +1,89 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <QAtomicPointer>
+
+// An unbounded queue for exactly one thread adding items (push) and one thread taking them 
+// (pop), without any lock. The items are kept in a linked list, whose first node is a dummy
+// owned by the consumer. The producer only touches the last node, so both threads never 
+// write the same memory.
+template <typename T>
+class SpscQueue
+{
+public:
+    SpscQueue() {
+        _head = _tail = new Node;
+    };
+    ~SpscQueue() {
+        while (_head) {
+            Node *next = _head->next.loadAcquire();
+            delete _head;
+            _head = next;
+        }
+    };
+    
+    // Called by the producer:
+    void push(const T &value) {
+        Node *node = new Node;
+        node->value = value;
+        // publishes the value together with the node:
+        _tail->next.storeRelease(node);
+        _tail = node;
+    };
+    
+    // Called by the consumer. Returns false if the queue is empty:
+    bool pop(T &value) {
+        Node *next = _head->next.loadAcquire();
+        if (!next)
+            return false;
+        value = next->value;
+        // next becomes the dummy, its value is not needed anymore:
+        next->value = T();
+        delete _head;
+        _head = next;
+        return true;
+    };
+    
+    // Called by the consumer:
+    bool isEmpty() const { return _head->next.loadAcquire() == 0; };
+    
+private:
+    struct Node {
+        Node() : next(0) {};
+        T value;
+        QAtomicPointer<Node> next;
+    };
+    
+    // Disable copying:
+    SpscQueue(const SpscQueue &);
+    SpscQueue &operator=(const SpscQueue &);
+    
+    Node *_head; // consumer side
+    Node *_tail; // producer side
+};
+
+#endif // SPSCQUEUE_H
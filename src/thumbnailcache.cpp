@@ -0,0 +1,227 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "thumbnailcache.h"
+
+#define THUMBNAIL_MAGIC 0x4d54484d // "MHTM"
+#define THUMBNAIL_VERSION 2 // 2: images are turned upright according to their EXIF orientation
+
+// Every cache file starts with this header, followed by the pixel data (QImage::Format_ARGB32_Premultiplied).
+// Its size is a multiple of 16, so the mapped pixel data is well aligned.
+struct thumbnail_header_t {
+    quint32 magic;
+    quint32 version;
+    qint32 width, height, bytes_per_line;
+    // the image was decoded for tiles of this size:
+    qint32 tilesize;
+    double max_zoom;
+    QRgb bordercolor;
+    quint32 reserved[7];
+};
+
+// Called by QImage when the last copy of a cached image is deleted. Closing the file unmaps the memory:
+static void delete_mapped_file(void *file)
+{
+    delete static_cast<QFile*>(file);
+}
+
+
+ThumbnailCache::ThumbnailCache(const QString& cache_dir, const qint64 max_bytes) : 
+_dir(cache_dir), _max_bytes(max_bytes), _total_bytes(0)
+{
+    if (!_dir.mkpath(_dir.absolutePath()))
+        printf("WARNING: Could not create thumbnail cache directory %s\n", 
+               _dir.absolutePath().toStdString().c_str());
+    readIndex();
+    QMutexLocker locker(&_mutex);
+    evict();
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    writeIndex();
+}
+
+QString ThumbnailCache::key(const QString& filename)
+{
+    QString path;
+    qint64 mtime, size;
+    // (the file might be an entry of an image archive)
+    if (!image_file_info(filename, path, mtime, size))
+        return QString();
+    QByteArray id = path.toUtf8() + '\n' + QByteArray::number(mtime) + '\n' + QByteArray::number(size);
+    return QString::fromLatin1(QCryptographicHash::hash(id, QCryptographicHash::Sha1).toHex());
+}
+
+QImage ThumbnailCache::find(const QString& filename, const int tilesize, const double max_zoom, QColor& bordercolor)
+{
+    QString k = key(filename);
+    if (k.isEmpty())
+        return QImage();
+    {
+        QMutexLocker locker(&_mutex);
+        QHash<QString, Entry>::iterator it = _entries.find(k);
+        if (it == _entries.end())
+            return QImage();
+        it->last_used = QDateTime::currentMSecsSinceEpoch();
+    }
+    
+    QFile *file = new QFile(cacheFileName(k));
+    const uchar *data = NULL;
+    if (file->open(QIODevice::ReadOnly) && file->size() >= (qint64)sizeof(thumbnail_header_t))
+        data = file->map(0, file->size());
+    if (!data) {
+        delete file;
+        return QImage();
+    }
+    const thumbnail_header_t *header = reinterpret_cast<const thumbnail_header_t*>(data);
+    if (header->magic != THUMBNAIL_MAGIC || header->version != THUMBNAIL_VERSION ||
+        (qint64)sizeof(thumbnail_header_t) + (qint64)header->bytes_per_line * header->height > file->size() ||
+        header->tilesize < tilesize || header->max_zoom < max_zoom) 
+    {
+        // invalid file or too small for the current tiles
+        delete file;
+        return QImage();
+    }
+    bordercolor = QColor(header->bordercolor);
+    // The image references the mapped memory, which stays valid until the last copy of the
+    // image is deleted:
+    return QImage(data + sizeof(thumbnail_header_t), header->width, header->height, header->bytes_per_line,
+                  QImage::Format_ARGB32_Premultiplied, delete_mapped_file, file);
+}
+
+void ThumbnailCache::insert(const QString& filename, const int tilesize, const double max_zoom, 
+                            const QImage& image, const QColor& bordercolor)
+{
+    if (image.isNull())
+        return;
+    QString k = key(filename);
+    if (k.isEmpty())
+        return;
+    QImage pixels = image.format() == QImage::Format_ARGB32_Premultiplied ? 
+                    image : image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    
+    thumbnail_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = THUMBNAIL_MAGIC;
+    header.version = THUMBNAIL_VERSION;
+    header.width = pixels.width();
+    header.height = pixels.height();
+    header.bytes_per_line = pixels.bytesPerLine();
+    header.tilesize = tilesize;
+    header.max_zoom = max_zoom;
+    header.bordercolor = bordercolor.rgb();
+    
+    // QSaveFile writes to a temporary file first, so other threads never map a half written file:
+    QSaveFile file(cacheFileName(k));
+    if (!file.open(QIODevice::WriteOnly)) {
+        printf("WARNING: Could not write thumbnail cache file %s\n", file.fileName().toStdString().c_str());
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(pixels.constBits()), pixels.byteCount());
+    if (!file.commit()) {
+        printf("WARNING: Could not write thumbnail cache file %s\n", file.fileName().toStdString().c_str());
+        return;
+    }
+    
+    QMutexLocker locker(&_mutex);
+    Entry entry;
+    entry.bytes = sizeof(header) + pixels.byteCount();
+    entry.last_used = QDateTime::currentMSecsSinceEpoch();
+    // replace a previous (smaller) version:
+    QHash<QString, Entry>::iterator previous = _entries.find(k);
+    if (previous != _entries.end())
+        _total_bytes -= previous->bytes;
+    _entries.insert(k, entry);
+    _total_bytes += entry.bytes;
+    if (_total_bytes > _max_bytes)
+        evict();
+}
+
+qint64 ThumbnailCache::sizeInBytes() const
+{
+    QMutexLocker locker(&_mutex);
+    return _total_bytes;
+}
+
+void ThumbnailCache::readIndex()
+{
+    QMutexLocker locker(&_mutex);
+    // all cache files that exist, with their modification time as last usage:
+    QFileInfoList files = _dir.entryInfoList(QStringList("*.thumb"), QDir::Files);
+    for (int i = 0; i < files.count(); ++i) {
+        Entry entry;
+        entry.bytes = files.at(i).size();
+        entry.last_used = files.at(i).lastModified().toMSecsSinceEpoch();
+        _entries.insert(files.at(i).completeBaseName(), entry);
+        _total_bytes += entry.bytes;
+    }
+    // the index file has the actual last usage (one line per entry: "key last_used"):
+    QFile index(_dir.filePath("index"));
+    if (!index.open(QIODevice::ReadOnly))
+        return;
+    while (!index.atEnd()) {
+        QList<QByteArray> line = index.readLine().trimmed().split(' ');
+        if (line.count() != 2)
+            continue;
+        QHash<QString, Entry>::iterator it = _entries.find(QString::fromLatin1(line.at(0)));
+        if (it != _entries.end())
+            it->last_used = line.at(1).toLongLong();
+    }
+}
+
+void ThumbnailCache::writeIndex() const
+{
+    QMutexLocker locker(&_mutex);
+    QSaveFile index(_dir.filePath("index"));
+    if (!index.open(QIODevice::WriteOnly))
+        return;
+    QHash<QString, Entry>::const_iterator it;
+    for (it = _entries.constBegin(); it != _entries.constEnd(); ++it)
+        index.write(it.key().toLatin1() + ' ' + QByteArray::number(it->last_used) + '\n');
+    index.commit();
+}
+
+void ThumbnailCache::evict()
+{
+    if (_total_bytes <= _max_bytes)
+        return;
+    // sort by last usage:
+    QMap<qint64, QString> by_usage;
+    QHash<QString, Entry>::const_iterator it;
+    for (it = _entries.constBegin(); it != _entries.constEnd(); ++it)
+        by_usage.insertMulti(it->last_used, it.key());
+    // Delete a bit more than necessary, so not every insert must evict something.
+    // A file which is still mapped can't be deleted on some systems, but stays in the index 
+    // then and is tried again next time:
+    QMap<qint64, QString>::const_iterator oldest = by_usage.constBegin();
+    while (_total_bytes > 0.9 * _max_bytes && oldest != by_usage.constEnd()) {
+        if (QFile::remove(cacheFileName(oldest.value())) || !QFile::exists(cacheFileName(oldest.value()))) {
+            _total_bytes -= _entries.value(oldest.value()).bytes;
+            _entries.remove(oldest.value());
+        }
+        ++oldest;
+    }
+}
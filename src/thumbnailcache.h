@@ -0,0 +1,93 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QImage>
+#include <QColor>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include "imagearchive.h"
+#include <stdio.h> // for printf()
+#include <string.h> // for memset()
+
+// A persistent cache of down-scaled tile images on the hdd, so images that were used in a 
+// previous game don't need to be decoded again. An entry is identified by the image's absolute
+// path, modification time and file size. The pixels are stored premultiplied and uncompressed,
+// and a cached image is memory-mapped instead of read, i.e. a cache hit costs just a page-in.
+// If the cache grows larger than its size limit, the least recently used entries are deleted.
+// All public methods are thread-safe.
+class ThumbnailCache
+{
+public:
+    // The cache files are saved in directory cache_dir, which is created if necessary.
+    // max_bytes is the size limit of all cache files together.
+    ThumbnailCache(const QString &cache_dir, const qint64 max_bytes);
+    // Saves the usage information needed for evicting the least recently used entries:
+    ~ThumbnailCache();
+    
+    // Returns the cached image of file filename if it has been stored for tiles of at least size
+    // tilesize and max_zoom. Otherwise, a null image is returned. On success, bordercolor is set to
+    // the border color saved with the image. The returned image references the mapped file and 
+    // must not be modified (it would be copied).
+    QImage find(const QString &filename, const int tilesize, const double max_zoom, QColor &bordercolor);
+    // Saves image (will be converted to premultiplied ARGB32 if necessary), which was decoded
+    // from filename for tiles of size tilesize and max_zoom, together with its bordercolor:
+    void insert(const QString &filename, const int tilesize, const double max_zoom, 
+                const QImage &image, const QColor &bordercolor);
+    
+    qint64 sizeInBytes() const;
+    
+private:
+    struct Entry { qint64 bytes; qint64 last_used; };
+    
+    // Returns the cache key of filename, or an empty string if the file does not exist:
+    static QString key(const QString &filename);
+    QString cacheFileName(const QString &key) const { return _dir.filePath(key + ".thumb"); };
+    // reads and writes the usage information of all entries:
+    void readIndex();
+    void writeIndex() const;
+    // Deletes least recently used entries until all entries fit in _max_bytes. _mutex must be locked.
+    void evict();
+    
+    QDir _dir;
+    const qint64 _max_bytes;
+    qint64 _total_bytes;
+    QHash<QString, Entry> _entries;
+    mutable QMutex _mutex;
+    
+    // no copying
+    ThumbnailCache(const ThumbnailCache&);
+    ThumbnailCache& operator=(const ThumbnailCache&);
+};
+
+#endif // THUMBNAILCACHE_H
@@ -24,47 +24,53 @@
 
 #include "tile.h"
 
+// Number of steps between the normal and the fully zoomed size, at which the face is composed:
+#define FACE_ZOOM_STEPS 16
+// Duration of turning a tile over:
+#define FLIP_DURATION_MS 400
+
 Tile::Tile(const uint id, const QPoint position, const int bordersize, const double zoom_factor, 
            QGraphicsItem* parent)
 : QGraphicsObject(parent), _id(id), _position(position), _bordersize(bordersize), _max_zoom(zoom_factor)
 {
-    // create dummy Image:
-    _image = new QImage();
     _flipped = true;
+    _flipping = false;
     _flipping_angle = 0;
+    _flip_progress = 0;
+    _flip_start_ms = 0;
     _current_size = _size = QSize(0, 0);
     _current_scaling_value = _scaling_value = 0.5;
     _bordercolor = QColor("white");
     _backside_image = NULL;
+    _image_level = 0;
+    _face_cache = NULL;
+    _face_dirty = true;
+    _atlas = NULL;
+    _batched = false;
     _zoom_factor = 0;
     
     _last_mouse_coords.setX(0);
     _last_mouse_coords.setY(0);
-    setAcceptHoverEvents(true);
+    _hover_pending = false;
+    _hovered = false;
+    setAcceptedMouseButtons(Qt::NoButton);
 }
 
 Tile::~Tile()
 {
-    if (_timer.isActive())
-        _timer.stop();
 }
 
 
 void Tile::setSize(const QSize& newSize)
 {
     _current_size = _size = newSize;
-    calcImageRects();
+    _face_dirty = true;
+    updateGeometry();
 }
 
 QRectF Tile::boundingRect() const
 {
-    if (_flipping_angle)
-        // make it bigger than it actually is, because the size increases slightly during flipping:
-        return QRectF(-0.75 * _current_size.width(), -0.75 * _current_size.height(), 
-                      1.5 * _current_size.width(), 1.5 * _current_size.height());
-    else
-        return QRectF(-0.5 * _current_size.width(), -0.5 * _current_size.height(), 
-                      _current_size.width(), _current_size.height());
+    return _bounding_rect;
 }
 
 void Tile::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
@@ -74,9 +80,8 @@ void Tile::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWid
 
     // much nicer images, especially if up-scaled:
     painter->setRenderHint(QPainter::SmoothPixmapTransform);
-    painter->setRenderHint(QPainter::Antialiasing);
     
-    if (_flipping_angle) {
+    if (_flipping) {
         QTransform transform = painter->transform();
         transform.rotate(_flipping_angle, Qt::YAxis);
         painter->setTransform(transform);
@@ -96,23 +101,24 @@ void Tile::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWid
                 *_backside_image);
         else {
             // just in case...
+            painter->setRenderHint(QPainter::Antialiasing);
             painter->setBrush(QBrush("darkGray"));
             painter->drawRoundedRect(r, _bordersize, _bordersize);
         }
     }
     else {
-        //QLinearGradient gradient(r.topLeft(), r.bottomRight());
-        QRadialGradient gradient(QPointF(0, 0), _current_size.height() * 1.4, _last_mouse_coords);
-        gradient.setColorAt(1, _bordercolor);
-        gradient.setColorAt(0.5, _bordercolor);
-        gradient.setColorAt(0, QColor::fromRgbF(1, 1, 1, 1));
-        painter->setBrush(QBrush(gradient));
-        painter->drawRoundedRect(r, _bordersize, _bordersize);
-        if (_image->isNull())
-            //:This text is shown on a tile while the tile image loads.
-            painter->drawText(r, Qt::AlignCenter, tr("Please\nwait..."));
-        else
-            painter->drawImage(_image_destination_rect, *_image, _image_source_rect);
+        // Rendering the rounded frame and scaling the image in every frame is slow, so the face is 
+        // composed only if the size reaches another zoom step, and just drawn here:
+        QSize face_size = faceSize();
+        if (_face_dirty || _face.size() != face_size)
+            composeFace(face_size);
+        QRectF target(-0.5 * _current_size.width(), -0.5 * _current_size.height(),
+                      _current_size.width(), _current_size.height());
+        if (target.size() == QSizeF(face_size) && !_flipping)
+            // not scaled, so no need to interpolate:
+            painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+        painter->drawImage(target, _face);
+        drawHighlight(painter, target);
     }
     //TODO following only for debug:
     //painter->drawText(r, Qt::AlignBottom, QString::number(get_id()));
@@ -123,16 +129,29 @@ void Tile::setBacksideImage(const QImage* newImage)
     _backside_image = newImage;
 }
 
-void Tile::setImage(QImage* img, const QColor bordercolor)
+void Tile::setFaceCache(TileFaceCache* cache)
+{
+    _face_cache = cache;
+    _face_dirty = true;
+}
+
+void Tile::setAtlas(TileAtlas* atlas)
 {
-    // delete previous (dummy) image:
-    delete _image;
-    _image = img;
+    _atlas = atlas;
+    updateBatching();
+}
+
+void Tile::setImage(const ImagePyramid &levels, const QColor bordercolor)
+{
+    _image_levels = levels;
     _bordercolor = bordercolor;
-    calcImageRects();
-    if (!_flipped && !_flipping_angle) {
+    _face_dirty = true;
+    if (_atlas)
+        _atlas->removeFace(_id);
+    if (!_flipped && !_flipping) {
         update();
     }
+    updateBatching();
 }
 
 
@@ -148,76 +167,85 @@ void Tile::setScalingValue(const double factor)
     else
         _scaling_value = factor;
     _current_scaling_value = _scaling_value;
-    calcImageRects();
+    _face_dirty = true;
+    if (_atlas)
+        _atlas->removeFace(_id);
+    updateBatching();
 }
 
-void Tile::flip()
+void Tile::flip(const qint64 start_ms)
 {
-    _timerstep = 0;
-    _timer.start(40, this);
+    _flipping = true;
+    _flip_progress = 0;
+    _flip_start_ms = start_ms;
 }
 
-void Tile::mousePressEvent(QGraphicsSceneMouseEvent* event)
+bool Tile::animate(const qint64 now_ms)
 {
-    if (!_flipping_angle && event->button() == Qt::LeftButton){
-        emit tileClicked(this);
+    if (_hover_pending) {
+        _hover_pending = false;
+        if (_hovered)
+            calcZoomFactor(_last_mouse_coords);
+        else
+            _zoom_factor = 0;
     }
+    if (!_flipping) {
+        calcZoomedSize();
+        updateGeometry();
+        return false;
+    }
+    double progress = fmin(1.0, fmax(0.0, (now_ms - _flip_start_ms) / double(FLIP_DURATION_MS)));
+    if (_flip_progress < 0.5 && progress >= 0.5) {
+        // halfway through, paint the other side of the card:
+        _flipped = !_flipped;
+        // the face is not needed while the backside is shown:
+        if (_flipped)
+            _face = QImage();
+    }
+    _flip_progress = progress;
+    if (progress < 0.5)
+        _flipping_angle = -180 * progress;
+    else
+        // go from +90 degrees to 0 so the final image is not mirrored:
+        _flipping_angle = 180 * (1.0 - progress);
+    if (progress >= 1.0) {
+        // finished
+        _flipping = false;
+        _flipping_angle = 0;
+    }
+    calcZoomedSize();
+    updateGeometry();
+    if (!_flipping)
+        emit tileFlipped(this);
+    return _flipping;
 }
 
-void Tile::hoverMoveEvent(QGraphicsSceneHoverEvent* event)
+void Tile::mouseMoved(const QPointF& pos)
 {
-    _last_mouse_coords = event->pos();
-    calcZoomFactor(event->pos());
-    calcZoomedSize();
-    calcImageRects();
-    update();
+    _last_mouse_coords = pos;
+    _hovered = true;
+    if (!_hover_pending) {
+        _hover_pending = true;
+        emit animationRequested(this);
+    }
 }
 
-void Tile::hoverEnterEvent(QGraphicsSceneHoverEvent* event)
+void Tile::mouseEntered()
 {
-    (void) event; // suppress unused-parameter warning
-
     // move to top:
     setZValue(100);
+    emit tileHovered(this);
 }
 
-void Tile::hoverLeaveEvent(QGraphicsSceneHoverEvent* event)
+void Tile::mouseLeft()
 {
-    (void) event; // suppress unused-parameter warning
-
     // reset z value:
     setZValue(0);
-    prepareGeometryChange();
-    _current_scaling_value = _scaling_value;
-    _current_size = _size;
-    calcImageRects();
-}
-
-void Tile::timerEvent(QTimerEvent* event)
-{
-    if (event->timerId() == _timer.timerId()) {
-        prepareGeometryChange();
-        _flipping_angle -= 18;
-        _timerstep++;
-        if (_timerstep == 5) {
-            // halfway through
-            // now, flipping_angle is -90
-            // go to +90 degrees so the final image is not mirrored:
-            _flipping_angle = 90;
-            // paint the other side of the card:
-            _flipped = !_flipped;
-        }
-        if (_timerstep > 9) {
-            // finished
-            _flipping_angle = 0;
-            _timer.stop();
-            emit tileFlipped(this);
-        }
-        calcZoomedSize();
-        calcImageRects();
-        update();   
-    } else {
-        QObject::timerEvent(event);
+    // back to normal size in the next frame:
+    _hovered = false;
+    if (!_hover_pending) {
+        _hover_pending = true;
+        emit animationRequested(this);
     }
 }
 
@@ -244,15 +272,15 @@ void Tile::calcZoomedSize()
     // This depends on whether we see the front or the back (backside has max zoom of 1.1)
     // and there is also a transition during flipping.
     double zoom;
-    if (_flipping_angle) {
+    if (_flipping) {
         // currently flipping -> we need to calculate transition
-        if ((_flipped && _timerstep < 5) || (!_flipped && _timerstep >= 5)) {
+        if ((_flipped && _flip_progress < 0.5) || (!_flipped && _flip_progress >= 0.5)) {
             // transition from backside to front (i.e. from 1.1 to max_zoom)
-            zoom = (_max_zoom - 1.1) * _timerstep / 10.0 + 1.1;
+            zoom = (_max_zoom - 1.1) * _flip_progress + 1.1;
         }
         else {
             // transition from front side to back (i.e. from max_zoom to 1.1)
-            zoom = (1.1 - _max_zoom) * _timerstep / 10.0 + _max_zoom;
+            zoom = (1.1 - _max_zoom) * _flip_progress + _max_zoom;
         }
     }
     else
@@ -260,28 +288,40 @@ void Tile::calcZoomedSize()
     
     int maxwidth = _size.width() * zoom;
     int maxheight = _size.height() * zoom;
-    prepareGeometryChange();
     _current_size.setWidth((maxwidth - _size.width()) * _zoom_factor + _size.width());
     _current_size.setHeight((maxheight - _size.height()) * _zoom_factor + _size.height());
 }
 
-void Tile::calcImageRects()
+void Tile::calcImageRects(const QSizeF &size, const double scaling_value)
 {
-    double scaleH = (_current_size.width() - 2*_bordersize) / double(_image->width());
-    double scaleV = (_current_size.height() - 2*_bordersize) / double(_image->height());
+    _image_level = 0;
+    if (_image_levels.isEmpty())
+        return;
+    const QImage &image = _image_levels[0];
+    double scaleH = (size.width() - 2*_bordersize) / double(image.width());
+    double scaleV = (size.height() - 2*_bordersize) / double(image.height());
     double scale_min = fmin(scaleH, scaleV);
     double scale_max = fmax(scaleH, scaleV);
     
     // scaling goes linearly from scale_max to scale_min with current_scaling_value 0..1:
-    double scaling = (scale_min - scale_max) * _current_scaling_value + scale_max;
+    double scaling = (scale_min - scale_max) * scaling_value + scale_max;
+    
+    double src_width = fmin(image.width(), (size.width() - 2*_bordersize) / scaling);
+    double src_height = fmin(image.height(), (size.height() - 2*_bordersize) / scaling);
+    double dst_width = fmin(size.width() - 2*_bordersize, image.width() * scaling);
+    double dst_height = fmin(size.height() - 2*_bordersize, image.height() * scaling);
     
-    double src_width = fmin(_image->width(), (_current_size.width() - 2*_bordersize) / scaling);
-    double src_height = fmin(_image->height(), (_current_size.height() - 2*_bordersize) / scaling);
-    double dst_width = fmin(_current_size.width() - 2*_bordersize, _image->width() * scaling);
-    double dst_height = fmin(_current_size.height() - 2*_bordersize, _image->height() * scaling);
+    // the smallest level that is still at least as big as the image on the tile:
+    while (_image_level + 1 < _image_levels.size() && 
+           _image_levels[_image_level + 1].width() >= image.width() * scaling)
+        _image_level++;
+    // source rectangle in coordinates of this level (all levels have the same aspect ratio):
+    double level_scaling = _image_levels[_image_level].width() / double(image.width());
+    src_width *= level_scaling;
+    src_height *= level_scaling;
     _image_source_rect.setRect(
-        (_image->width() - src_width) / 2.0,
-        (_image->height() - src_height) / 2.0,
+        (_image_levels[_image_level].width() - src_width) / 2.0,
+        (_image_levels[_image_level].height() - src_height) / 2.0,
         src_width,
         src_height
     );
@@ -293,6 +333,118 @@ void Tile::calcImageRects()
     );
 }
 
+QRectF Tile::calcBoundingRect() const
+{
+    QRectF r(-0.5 * _current_size.width(), -0.5 * _current_size.height(), 
+             _current_size.width(), _current_size.height());
+    if (_flipping)
+        // The perspective makes the card bigger on the side turning towards the viewer. 
+        // This is the rectangle around it, plus a pixel for the antialiasing:
+        return QTransform().rotate(_flipping_angle, Qt::YAxis).mapRect(r).adjusted(-1, -1, 1, 1);
+    return r;
+}
+
+void Tile::updateGeometry()
+{
+    QRectF r = calcBoundingRect();
+    if (r != _bounding_rect) {
+        // the old and the new rectangle are repainted:
+        prepareGeometryChange();
+        _bounding_rect = r;
+    }
+    else
+        update();
+    updateBatching();
+}
+
+void Tile::updateBatching()
+{
+    bool batched = _atlas && _atlas->isValid() && _atlas->tileSize() == _size && !_flipping && 
+                   !_hovered && !_hover_pending && _current_size == QSizeF(_size);
+    bool face_added = false;
+    if (batched && !_flipped && !_atlas->hasFace(_id)) {
+        if (_image_levels.isEmpty())
+            // the text shown while the image loads is painted by the tile
+            batched = false;
+        else {
+            if (_face_dirty || _face.size() != _size)
+                composeFace(_size);
+            batched = face_added = _atlas->setFace(_id, _face);
+        }
+    }
+    if (batched == _batched && !face_added)
+        return;
+    _batched = batched;
+    // The view does not call paint of tiles without contents. Their area is drawn from the atlas 
+    // with the background, so it is repainted by the scene, as the tile's updates are ignored:
+    setFlag(QGraphicsItem::ItemHasNoContents, batched);
+    if (scene())
+        scene()->update(sceneBoundingRect());
+}
+
+QSize Tile::faceSize() const
+{
+    // the zoomed size goes from size up to max_zoom * size:
+    double step_width = fmax(1.0, _size.width() * (_max_zoom - 1) / FACE_ZOOM_STEPS);
+    double step_height = fmax(1.0, _size.height() * (_max_zoom - 1) / FACE_ZOOM_STEPS);
+    return QSize(qRound(_size.width() + qRound((_current_size.width() - _size.width()) / step_width) * step_width),
+                 qRound(_size.height() + qRound((_current_size.height() - _size.height()) / step_height) * step_height));
+}
+
+void Tile::composeFace(const QSize& face_size)
+{
+    if (face_size.isEmpty()) {
+        _face = QImage();
+        return;
+    }
+    // The frame is shared, painting on it detaches a copy for this tile:
+    if (_face_cache)
+        _face = _face_cache->frame(face_size, _bordercolor, _bordersize);
+    else
+        _face = TileFaceCache::renderFrame(face_size, _bordercolor, _bordersize);
+    _face_dirty = false;
+    
+    QPainter painter(&_face);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.translate(0.5 * face_size.width(), 0.5 * face_size.height());
+    if (_image_levels.isEmpty()) {
+        // frame minus pen width:
+        QRectF r(-0.5 * face_size.width(), -0.5 * face_size.height(), 
+                 face_size.width() - 1, face_size.height() - 1);
+        //:This text is shown on a tile while the tile image loads.
+        painter.drawText(r, Qt::AlignCenter, tr("Please\nwait..."));
+        _image_destination_rect = QRectF();
+    }
+    else {
+        calcImageRects(face_size, _current_scaling_value);
+        painter.drawImage(_image_destination_rect, _image_levels[_image_level], _image_source_rect);
+    }
+}
+
+void Tile::drawHighlight(QPainter* painter, const QRectF& target)
+{
+    // This replaces the radial gradient from white at the mouse position to the border color 
+    // at 0.7 times the height, which was used as the background of the image:
+    // (in steps of 8 pixels, so there are only a few of them in the cache)
+    int radius = qRound(0.7 * target.height() / 8) * 8;
+    if (radius < 8 || _face.isNull())
+        return;
+    // only visible on the border, so clip off the image and the rounded corners:
+    double sx = target.width() / _face.width(), sy = target.height() / _face.height();
+    QRect outer = target.toAlignedRect();
+    QRegion border = QRegion(outer.adjusted(_bordersize, 0, -_bordersize, 0)) + 
+                     QRegion(outer.adjusted(0, _bordersize, 0, -_bordersize));
+    if (!_image_destination_rect.isEmpty())
+        border -= QRegion(QRectF(_image_destination_rect.x() * sx, _image_destination_rect.y() * sy,
+                                 _image_destination_rect.width() * sx, 
+                                 _image_destination_rect.height() * sy).toRect());
+    QImage highlight = _face_cache ? _face_cache->highlight(radius) : TileFaceCache::renderHighlight(radius);
+    painter->save();
+    painter->setClipRegion(border);
+    painter->drawImage(QPointF(_last_mouse_coords.x() - radius, _last_mouse_coords.y() - radius), highlight);
+    painter->restore();
+}
+
 
 // necessary for Qt's meta objectc compiler, e.g. for signal-slot-system:
 //#include "tile.moc"
@@ -26,14 +26,18 @@
 #define TILE_H
 
 #include <QGraphicsObject>
-#include <QBasicTimer>
+#include <QVector>
 #include <QPainter>
 #include <QGraphicsSceneMouseEvent>
 #include <stdio.h> // for printf()
 #include <math.h>
+#include "imagepyramid.h"
+#include "tilefacecache.h"
+#include "tileatlas.h"
 
 #define PI 3.1415926535897
 
+
 class Tile : public QGraphicsObject
 {
     // necessary for Qt's meta objectc compiler, e.g. for signal-slot-system:
@@ -54,6 +58,15 @@ public:
     // just referenced here. For best quality, the image should be updated if the tile is resized.
     // The Tile class does not take ownership of the image, it must be deleted outside.
     void setBacksideImage(const QImage *newImage);
+    // The frames and the highlight of the face are also shared by all tiles (see TileFaceCache).
+    // Without a cache, the tile renders them itself. The Tile class does not take ownership.
+    void setFaceCache(TileFaceCache *cache);
+    // With an atlas, the tile does not paint itself while it is at rest (not zoomed or flipping),
+    // but is drawn from the atlas together with the other tiles at rest (see TileAtlas). 
+    // The tile adds its face to the atlas when needed. The Tile class does not take ownership.
+    void setAtlas(TileAtlas *atlas);
+    // true while the tile is drawn from the atlas:
+    bool is_batched() const { return _batched; };
     
     // Sets the image scaling value. factor must be between 0.0 and 1.0. A value of 0.0 will scale
     // the image so that it fills the entire tile, cutting a part of the image off if its aspect ratio
@@ -65,25 +78,38 @@ public:
     
     uint get_id() const { return _id; } ;
     bool is_flipped() const { return _flipped; };
+    bool is_flipping() const { return _flipping; };
     QPoint get_pos() const { return _position; };
     
+    // Moves the flipping animation on to the time now_ms (in ms, on the same clock as the start time
+    // given to flip), and applies the mouse movements since the last frame. Returns false once the 
+    // tile has finished flipping (after emitting tileFlipped) or, if it was not flipping, right away.
+    // All flipping tiles are animated together by MemoryView in each frame, so this just computes 
+    // the state at that time; if a frame is late, the animation skips ahead instead of lagging behind.
+    bool animate(const qint64 now_ms);
+    
+    // The mouse is dispatched to the tiles by MemoryView, which finds them in its grid of tiles 
+    // (see MemoryView::tileAt), so the tiles do not accept hover and mouse events from the scene.
+    // pos is given in coordinates of the tile:
+    void mouseEntered();
+    void mouseMoved(const QPointF &pos);
+    void mouseLeft();
+    
 public slots:
-    void flip(); 
+    // Starts turning the tile over at the time start_ms (see animate):
+    void flip(const qint64 start_ms); 
     // Multiple tiles also share the same foreground image, so this is also created outside of the 
-    // Tile class and just referenced here. No need to update this image during a resize.
-    // The Tile class does not take ownership of the image, it must be deleted outside.
-    void setImage(QImage *img, const QColor bordercolor);
+    // Tile class. QImage is implicitly shared, so all tiles reference the same pixel data.
+    // This can be called again, e.g. with a bigger version of the image after a resize.
+    void setImage(const ImagePyramid &levels, const QColor bordercolor);
     
 signals:
-    void tileClicked(Tile *tile);
     void tileFlipped(Tile *tile);
-    
-protected:
-    virtual void mousePressEvent (QGraphicsSceneMouseEvent *event);
-    virtual void hoverMoveEvent(QGraphicsSceneHoverEvent *event);
-    virtual void hoverEnterEvent(QGraphicsSceneHoverEvent *event);
-    virtual void hoverLeaveEvent(QGraphicsSceneHoverEvent *event);
-    virtual void timerEvent(QTimerEvent *event);
+    // the mouse entered the tile:
+    void tileHovered(Tile *tile);
+    // The mouse moved over the tile. The tile is zoomed in animate, so all movements within a 
+    // frame cause just one change of its geometry. This is emitted once until animate is called.
+    void animationRequested(Tile *tile);
     
 private:
     // Calculates the zoom factor, (see below: double zoom_factor)
@@ -92,17 +118,43 @@ private:
     // updated beforehand with calcZoomFactor during mouse movement), and the current
     // state of the card (flipped or not / transition)
     void calcZoomedSize();
-    // Calculates rectangles needed to copy image to the tile, 
+    // The rectangle the tile covers at its current size, also while it is turned:
+    QRectF calcBoundingRect() const;
+    // Sets the bounding rect to calcBoundingRect after the size or the flipping angle changed,
+    // notifying the scene only if it is different, and schedules a repaint:
+    void updateGeometry();
+    // Decides whether the tile is drawn from the atlas, after its state changed:
+    void updateBatching();
+    // Calculates rectangles needed to copy image to a tile of size size, 
     // i.e. part of image that will be cut out (image_source_rect) and 
-    // rectangle where this part will be copied to (image_destination_rect):
-    void calcImageRects();
+    // rectangle where this part will be copied to (image_destination_rect).
+    // Also chooses the level of the image pyramid that will be drawn (image_level):
+    void calcImageRects(const QSizeF &size, const double scaling_value);
+    // The size the face is composed at: the current size rounded to the zoom steps, so while 
+    // zooming, the face is only composed again every few pixels (see paint):
+    QSize faceSize() const;
+    // Draws the frame and the image (or the text shown while it loads) into _face:
+    void composeFace(const QSize &face_size);
+    // Draws the highlight following the mouse over the border of the face drawn to target:
+    void drawHighlight(QPainter *painter, const QRectF &target);
 
     // The unique labels of a card:
     const uint _id; // cards with same image have same id
     const QPoint _position; 
 
-    QImage* _image;
+    ImagePyramid _image_levels;
+    // level drawn at the face size, image_source_rect is given in its coordinates,
+    // image_destination_rect in coordinates of the face, relative to its center:
+    int _image_level;
     QRectF _image_destination_rect, _image_source_rect;
+    TileFaceCache *_face_cache;
+    // The face composed of frame and image, drawn in one go while the size stays in the same zoom 
+    // step. It is only kept while the face is visible; face_dirty is set if it must be composed 
+    // again, e.g. after a new image arrived:
+    QImage _face;
+    bool _face_dirty;
+    TileAtlas *_atlas;
+    bool _batched;
     int _bordersize;
     QColor _bordercolor;
     double _max_zoom;
@@ -110,12 +162,13 @@ private:
     
     // if flipped, the card's backside is visible:
     bool _flipped; 
-    // while a card is being flipped, flipping_angle turns the card in 10 steps by 180 degrees:
-    // (see timerEvent)
-    int _flipping_angle;
-    // counts to 10 during flipping:
-    int _timerstep;
-    QBasicTimer _timer;
+    // true while the card is being turned over:
+    bool _flipping;
+    // while a card is being flipped, flipping_angle turns the card by 180 degrees (see animate):
+    double _flipping_angle;
+    // goes from 0.0 to 1.0 during flipping, which starts at flip_start_ms:
+    double _flip_progress;
+    qint64 _flip_start_ms;
         
     // During hoverMoveEvent, the tile changes its size and the image scaling value,
     // then the current_ variables below differ from the set values:
@@ -131,6 +184,10 @@ private:
     double _zoom_factor;
     
     QPointF _last_mouse_coords;
+    // mouse movements not applied yet (see animationRequested), hovered is false after the mouse left:
+    bool _hover_pending;
+    bool _hovered;
+    QRectF _bounding_rect;
 };
 
 
@@ -0,0 +1,84 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tileatlas.h"
+
+
+TileAtlas::TileAtlas()
+{
+    _columns = 0;
+    _num_slots = 0;
+}
+
+void TileAtlas::reset(const QSize& tilesize, const int num_faces, const QImage& backside)
+{
+    clear();
+    if (tilesize.isEmpty())
+        return;
+    _tilesize = tilesize;
+    _num_slots = num_faces + 1;
+    // about square:
+    _columns = int(ceil(sqrt(double(_num_slots))));
+    int rows = (_num_slots + _columns - 1) / _columns;
+    _pixmap = QPixmap(_columns * tilesize.width(), rows * tilesize.height());
+    _pixmap.fill(Qt::transparent);
+    QPainter painter(&_pixmap);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(slotRect(0), backside);
+}
+
+void TileAtlas::clear()
+{
+    _pixmap = QPixmap();
+    _tilesize = QSize();
+    _columns = 0;
+    _num_slots = 0;
+    _slots.clear();
+    _valid_faces.clear();
+}
+
+bool TileAtlas::setFace(const uint id, const QImage& face)
+{
+    if (!isValid() || face.size() != _tilesize)
+        return false;
+    if (!_slots.contains(id)) {
+        if (_slots.count() + 1 >= _num_slots)
+            return false;
+        _slots.insert(id, _slots.count() + 1);
+    }
+    QPainter painter(&_pixmap);
+    // replacing the transparent corners of a previous face, too:
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(slotRect(_slots.value(id)), face);
+    _valid_faces.insert(id);
+    return true;
+}
+
+QRect TileAtlas::slotRect(const int slot) const
+{
+    if (!_columns)
+        return QRect();
+    return QRect((slot % _columns) * _tilesize.width(), (slot / _columns) * _tilesize.height(),
+                 _tilesize.width(), _tilesize.height());
+}
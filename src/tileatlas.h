@@ -0,0 +1,75 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TILEATLAS_H
+#define TILEATLAS_H
+
+#include <QPixmap>
+#include <QImage>
+#include <QHash>
+#include <QSet>
+#include <QPainter>
+#include <math.h>
+
+// The backside and the faces of the tiles at their normal (not zoomed) size, packed into one 
+// pixmap. Tiles at rest are not painted one by one, but all together from this pixmap with 
+// QPainter::drawPixmapFragments (see MemoryView::drawBackground). The faces are added when 
+// the tiles are revealed. Only used in the GUI thread.
+class TileAtlas
+{
+public:
+    TileAtlas();
+    
+    // Makes room for the backside and num_faces faces of size tilesize, dropping all faces:
+    void reset(const QSize &tilesize, const int num_faces, const QImage &backside);
+    void clear();
+    bool isValid() const { return !_pixmap.isNull(); };
+    QSize tileSize() const { return _tilesize; };
+    const QPixmap &pixmap() const { return _pixmap; };
+    
+    // Copies face (of size tileSize) into the atlas as the face of the tiles with id. 
+    // Returns false if there is no room left.
+    bool setFace(const uint id, const QImage &face);
+    // The face of id is outdated, e.g. because a new image arrived:
+    void removeFace(const uint id) { _valid_faces.remove(id); };
+    bool hasFace(const uint id) const { return _valid_faces.contains(id); };
+    
+    // The rectangles of the images in the pixmap:
+    QRectF backsideRect() const { return slotRect(0); };
+    QRectF faceRect(const uint id) const { return slotRect(_slots.value(id, 0)); };
+    
+private:
+    QRect slotRect(const int slot) const;
+    
+    QPixmap _pixmap;
+    QSize _tilesize;
+    // The images are arranged in a grid of columns columns. Slot 0 has the backside, 
+    // the faces get the following slots in the order they are added:
+    int _columns;
+    int _num_slots;
+    QHash<uint, int> _slots;
+    QSet<uint> _valid_faces;
+};
+
+#endif // TILEATLAS_H
@@ -0,0 +1,85 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tilefacecache.h"
+
+
+TileFaceCache::TileFaceCache(const qint64 max_bytes) : _images(max_bytes / 1024)
+{
+}
+
+QImage TileFaceCache::frame(const QSize& size, const QColor& bordercolor, const int bordersize)
+{
+    QString key = QString("frame %1x%2 %3 %4").arg(size.width()).arg(size.height())
+                  .arg(bordercolor.rgba()).arg(bordersize);
+    QImage *cached = _images.object(key);
+    if (cached)
+        return *cached;
+    QImage image = renderFrame(size, bordercolor, bordersize);
+    // (QCache deletes an image bigger than the whole cache right away)
+    _images.insert(key, new QImage(image), image.byteCount() / 1024 + 1);
+    return image;
+}
+
+QImage TileFaceCache::highlight(const int radius)
+{
+    QString key = QString("highlight %1").arg(radius);
+    QImage *cached = _images.object(key);
+    if (cached)
+        return *cached;
+    QImage image = renderHighlight(radius);
+    // (QCache deletes an image bigger than the whole cache right away)
+    _images.insert(key, new QImage(image), image.byteCount() / 1024 + 1);
+    return image;
+}
+
+void TileFaceCache::clear()
+{
+    _images.clear();
+}
+
+QImage TileFaceCache::renderFrame(const QSize& size, const QColor& bordercolor, const int bordersize)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setBrush(bordercolor);
+    // (with the default pen, like the other items)
+    painter.drawRoundedRect(QRectF(0.5, 0.5, size.width() - 1, size.height() - 1), bordersize, bordersize);
+    return image;
+}
+
+QImage TileFaceCache::renderHighlight(const int radius)
+{
+    QImage image(2 * radius, 2 * radius, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    // the same colors as the gradient the tiles used to fill their frame with:
+    QRadialGradient gradient(QPointF(radius, radius), radius);
+    gradient.setColorAt(0, QColor::fromRgbF(1, 1, 1, 1));
+    gradient.setColorAt(1, QColor::fromRgbF(1, 1, 1, 0));
+    painter.fillRect(image.rect(), gradient);
+    return image;
+}
@@ -0,0 +1,60 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2014 Jürgen Probst
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TILEFACECACHE_H
+#define TILEFACECACHE_H
+
+#include <QImage>
+#include <QColor>
+#include <QCache>
+#include <QPainter>
+#include <QRadialGradient>
+
+// The ready-made parts of the tile faces, shared by all tiles: the frames (a rounded rectangle 
+// in the border color, the background of the image) for each size and border color, and the 
+// highlight which follows the mouse. Rendering them with antialiasing and gradients is slow, 
+// so it is done only once, and the tiles just draw the images. Only used in the GUI thread.
+class TileFaceCache
+{
+public:
+    // max_bytes is the size limit of all images together, the least recently used are dropped.
+    TileFaceCache(const qint64 max_bytes = 32 * 1024 * 1024);
+    
+    // Returns the frame of a tile of size size with border color bordercolor and rounded 
+    // corners of radius bordersize:
+    QImage frame(const QSize &size, const QColor &bordercolor, const int bordersize);
+    // Returns a white spot of radius radius fading out to transparent:
+    QImage highlight(const int radius);
+    void clear();
+    
+    // Render the images without caching them:
+    static QImage renderFrame(const QSize &size, const QColor &bordercolor, const int bordersize);
+    static QImage renderHighlight(const int radius);
+    
+private:
+    // The cost of an entry is its size in kB:
+    QCache<QString, QImage> _images;
+};
+
+#endif // TILEFACECACHE_H
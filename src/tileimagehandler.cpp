@@ -27,248 +27,151 @@
 
 
 
-// A range of indexes starting at start_index with length range_len is shrinked in such a way, that 
-// the sum of all data points over the new range is maximized (data_len: length of int *data array). 
-// The new range_len will be halfed, the new start_index is the first index of the maximized index 
-// range. If the optional parameter roll_to_start_of_range is true, the new range is allowed to 
-// wrap over from the end of the old range to its start.
-// The supplied range may wrap over to the start of data.
-static void shrink_range(int &start_index, int &range_len, const int *data, const int data_len, 
-                         const bool roll_to_start_of_range = false){
-    int old_start = start_index, old_len = range_len, old_last = old_start + old_len - 1;
-    range_len = old_len / 2;
-    
-    // Integrate leftmost part of old area:
-    int sum = 0;
-    for (int i = old_start; i < old_start + range_len; i++)
-        if (i < data_len)
-            sum += data[i];
-        else
-            // roll over to beginning of data array:
-            sum += data[i - data_len];
-        
-        int max_sum = sum;
-    // shift the integration area:
-    for (int i = old_start + 1; i <= (roll_to_start_of_range ? old_last : old_last - range_len + 1); i++) {
-        // index of data to substract:
-        int sub_index = i - 1;
-        if (sub_index >= data_len)
-            // roll over to beginning of data array:
-            sub_index -= data_len;
-        // index of data to add:
-        int add_index = i + range_len - 1;
-        if (roll_to_start_of_range && add_index > old_last)
-            // roll over to beginning of old array:
-            add_index -= old_len;
-        if (add_index >= data_len)
-            // roll over to beginning of data array:
-            add_index -= data_len;
-        sum = sum - data[sub_index] + data[add_index];
-        if (sum > max_sum) {
-            max_sum = sum;
-            if (i >= data_len)
-                start_index = i - data_len;
-            else
-                start_index = i;
-        }
-    }
+// Returns the number of bytes used by the pixels of all levels:
+static qint64 image_bytes(const ImagePyramid &levels)
+{
+    qint64 bytes = 0;
+    for (int i = 0; i < levels.size(); ++i)
+        bytes += (qint64)levels[i].bytesPerLine() * levels[i].height();
+    return bytes;
 }
 
-static QColor get_most_prominent_hue(const QImage &image)
-{
-    //return QColor("green");
-    const QRgb *scanline;
-    int hue_count[360] = {0}; 
-    bool monochrome = true;
-    int h, s, v;
-    for (int i = 0; i < image.height(); i++) {
-        scanline = (const QRgb*) image.constScanLine(i);
-        for (int j = 0; j < image.width(); j++) {
-            QColor color(scanline[j]);
-            color.getHsv(&h, &s, &v);
-            //h = color.hue();
-            if (h != -1) {
-                hue_count[h]++;
-                if (monochrome)
-                    monochrome = false;
-            }
-        }
-    }
-    if (monochrome)
-        return QColor("black");
-    
-    int current_start_at = 0, current_num_candidates = 360;
-    // decrease number of candidates until only a few are left over:
-    shrink_range(current_start_at, current_num_candidates, hue_count, 360, true);
-    //printf("start %i, range %i\n", current_start_at, current_num_candidates);
-    while (current_num_candidates > 5) {
-        // Integrate hue_count over current_num_candidates/2 neigboring values, starting at current_start_at.
-        // Shift the integration area stepwise until the whole area has been probed in this way.
-        // The area with the highest integrated counts wins.
-        // This is calculated in this way so that larger ranges with a high amount of similar hue 
-        // are prefered over single high peaks of a very small hue range.
-        shrink_range(current_start_at, current_num_candidates, hue_count, 360, false);
-        //printf("start %i, range %i\n", current_start_at, current_num_candidates);
-    }
-    
-    // find maximum of last points:
-    int hue = -1, max_count = -1;
-    for (int i = current_start_at; i < current_start_at + current_num_candidates; i++) {
-        int idx = i;
-        if (idx >= 360)
-            // roll over to beginning of data array:
-            idx -= 360;
-        if (hue_count[idx] > max_count) {
-            max_count = hue_count[idx];
-            hue = idx;
-        }
-    }
-    printf("final hue: %i\n\n", hue);
-    return QColor::fromHsv(hue, 255, 255);
-}
-
-
-inline static int rgb2key(int r, int g, int b, int bitshift) {
-    //return 1;
-    return (((r >> bitshift) << 16) + 
-    ((g >> bitshift) <<  8) + 
-    (b >> bitshift) );
-}
-
-inline static int favorHue(int r, int g, int b) {
-    return (abs(r-g)*abs(r-g) + abs(r-b)*abs(r-b) + abs(g-b)*abs(g-b)) / 1000 + 1; 
-}
-
-// Algorithm from Pieroxy <pieroxy@pieroxy.net>,
-// more details here: http://pieroxy.net/blog/pages/color-finder/index.html 
-static int find_most_prominent_equivalence_class(const QHash<int, pixeldata_t> data, const int bitshift,
-                                                 const int allowed_key=0, const int allowed_key_bitshift=8) {
-    QHash<int, int> eqclass_counts;
-    int r, g, b, key = 0, count;
-    // scan through all pixels:
-    QHash<int, pixeldata_t>::const_iterator di;
-    for (di = data.constBegin(); di != data.constEnd(); ++di) {
-        // get rgb values:
-        r = di.value().r;
-        g = di.value().g;
-        b = di.value().b;
-        // check whether pixel belongs to allowed equivalence class allowed_key 
-        // by shifting it with corresponding allowed_key_bitshift:
-        if (rgb2key(r, g, b, allowed_key_bitshift) == allowed_key) {
-            // pixel is allowed, so designate a new equivalence key:
-            key = rgb2key(r, g, b, bitshift);
-            if (key != 0) { // discard very dark color
-                // add to the count for this key:
-                count = di.value().weight * di.value().count;
-                eqclass_counts.insert(key, eqclass_counts.value(key, 0) + count);
-            }
-        }
-    }
-    
-    // iterate through equivalence class counts and return most prominent member's key:
-    QHash<int, int>::const_iterator i;
-    count = 0;
-    for (i = eqclass_counts.constBegin(); i != eqclass_counts.constEnd(); ++i) {
-        if (i.value() > count) {
-            count = i.value();
-            key = i.key();
-        }
-    }
-    return key;
-}
-
-// Algorithm from Pieroxy <pieroxy@pieroxy.net>,
-// more details here: http://pieroxy.net/blog/pages/color-finder/index.html                
-static QColor get_most_prominent_color(const QImage &image, const int max_pixel = 5000) {
-    const QRgb *rgbdata;
-    QHash<int, pixeldata_t> data;
-    pixeldata_t pd;
-    int key;
-    int pixelcount = image.width() * image.height();
-    // we don't need to count all pixels, so skip some:
-    int skip = pixelcount < max_pixel ? 1 : pixelcount / max_pixel;
-
-    QRgb pixel;
-    int r, g, b;
-    bool monochrome = true;
-    rgbdata = (const QRgb*) image.constBits();
-    // count the occurences of rgb-triplets and save in data:
-    for (int i = 0; i < pixelcount; i += skip) {
-        // get rgb values:
-        pixel = rgbdata[i];
-        r = qRed(pixel);
-        g = qGreen(pixel);
-        b = qBlue(pixel);
-        key = rgb2key(r, g, b, 0);
-        if (data.contains(key)){
-            pd = data.value(key);
-            pd.count++;
-            data[key] = pd;
-        }
-        else {
-            pd.r = r;
-            pd.g = g;
-            pd.b = b;
-            // The count of this color will later be multiplied by this weight factor,
-            // which gives us the possibility to tweak the final winning color:
-            pd.weight = favorHue(r, g, b);
-            pd.count = 1;
-            data.insert(key, pd);
-            if (r != g || g != b)
-                monochrome = false;
-        }
+
+ImageDecodeWorker::ImageDecodeWorker(TileImageHandler* handler) : _handler(handler)
+{
+}
+
+void ImageDecodeWorker::run()
+{
+    uint index;
+    QString filename;
+    int tilesize;
+    double max_zoom;
+    while (_handler->takeNextImage(index, filename, tilesize, max_zoom))
+        decode(index, filename, tilesize, max_zoom);
+}
+
+void ImageDecodeWorker::decode(const uint index, const QString& filename, const int tilesize, const double max_zoom)
+{
+    ImagePyramid levels;
+    QColor bordercolor;
+    LoaderStatistics *statistics = _handler->statistics();
+    StageClock clock(statistics);
+    ImageCache *memory_cache = _handler->imageCache();
+    if (memory_cache && memory_cache->find(filename, tilesize, max_zoom, levels, bordercolor)) {
+        clock.lap(LoaderStatistics::STAGE_LOOKUP);
+        if (statistics)
+            statistics->addImage(LoaderStatistics::SOURCE_MEMORY_CACHE);
+    } else {
+        // not decoded in a recent game:
+        levels = decode_image_levels(filename, tilesize, max_zoom, _handler->imageIndex(), 
+                                     _handler->packedDeck(), _handler->thumbnailCache(), _handler->cancelToken(), bordercolor,
+                                     _handler, index, statistics);
+        if (memory_cache && !levels.isEmpty() && !_handler->isLoadingCanceled())
+            memory_cache->insert(filename, tilesize, max_zoom, levels, bordercolor);
     }
+    // let the handler distribute the image in its own thread:
+    QMetaObject::invokeMethod(_handler, "imageDecoded", Qt::QueuedConnection,
+                              Q_ARG(uint, index), Q_ARG(ImagePyramid, levels), 
+                              Q_ARG(QColor, bordercolor), Q_ARG(int, tilesize));
+}
 
-    if (monochrome)
-        return QColor("black");
 
-    // Divide data in equivalence classes (rightshift the r, g, b values by 6, i.e. integer divide by 64,
-    // which results in values between 0 and 3 for each component. Colors are in one equivalence class
-    // if they have the same right-shifted components.) The equivalence class with the most members wins.
-    // When counting the members, their number of occurence is multiplied by their weight factor from above.
-    // The returned key denotes this equivalence class:
-    key = find_most_prominent_equivalence_class(data, 6);
-    // Now, only count the colors in the equivalence class which was most promiment before,
-    // but this time rightshift by 4, then by 2 and finally count the colors without shifting:
-    key = find_most_prominent_equivalence_class(data, 4, key, 6);
-    key = find_most_prominent_equivalence_class(data, 2, key, 4);
-    key = find_most_prominent_equivalence_class(data, 0, key, 2);
-    // key identifies the most prominent color. Transform to rgb-triplet:
-    r = key >> 16;
-    key -= (r << 16);
-    g = key >> 8;
-    key -= (g << 8);
-    b = key;
-    //printf("result: %i, %i, %i\n", r, g, b);
-    return QColor(r, g, b);
+ImagePrefetchTask::ImagePrefetchTask(const QStringList& filenames, const int tilesize, const double max_zoom, 
+                                     ImageCache* image_cache, ThumbnailCache* thumbnail_cache, 
+                                     const ImageIndex* image_index, const PackedDeck* packed_deck, 
+                                     QSharedPointer<QAtomicInt> canceled) :
+_filenames(filenames), _tilesize(tilesize), _maxZoom(max_zoom), _imageCache(image_cache), 
+_thumbnailCache(thumbnail_cache), _imageIndex(image_index), _packedDeck(packed_deck), _canceled(canceled)
+{
 }
 
+void ImagePrefetchTask::run()
+{
+    for (int i = 0; i < _filenames.count() && !_canceled->loadAcquire(); ++i) {
+        if (_imageCache->contains(_filenames.at(i), _tilesize, _maxZoom))
+            // e.g. used in the current game
+            continue;
+        QColor bordercolor;
+        ImagePyramid levels = decode_image_levels(_filenames.at(i), _tilesize, _maxZoom, _imageIndex, 
+                                                  _packedDeck, _thumbnailCache, _canceled.data(), bordercolor);
+        if (!levels.isEmpty() && !_canceled->loadAcquire())
+            _imageCache->insert(_filenames.at(i), _tilesize, _maxZoom, levels, bordercolor);
+    }
+}
 
 
 TileImageHandler::TileImageHandler(const uint num_images, const uint num_tiles_per_image, QObject* parent) : 
 QObject(parent), _numImages(num_images), _numTilesPerImage(num_tiles_per_image)
 {
     _fnames.reserve(num_images);
-    _images = new QImage*[num_images];
-    for (uint i = 0; i < num_images; ++i)
-        _images[i] = NULL;
+    // needed for queued signals and invokeMethod:
+    qRegisterMetaType<ImagePyramid>("ImagePyramid");
+    _images = new ImagePyramid[num_images];
+    _queuedPriorities = new int[num_images];
+    _requestedTileSizes = new int[num_images];
+    _queuedAt = new qint64[num_images];
+    _imageDecoded = new bool[num_images];
+    _borderColors = new QColor[num_images];
+    _pinCounts = new int[num_images];
+    _lastUsed = new quint64[num_images];
+    _evicted = new bool[num_images];
+    _released = new bool[num_images];
+    for (uint i = 0; i < num_images; ++i) {
+        _queuedPriorities[i] = -1;
+        _requestedTileSizes[i] = 0;
+        _queuedAt[i] = 0;
+        _imageDecoded[i] = false;
+        _pinCounts[i] = 0;
+        _lastUsed[i] = 0;
+        _evicted[i] = false;
+        _released[i] = false;
+    }
     _tiles = new Tile*[num_images * num_tiles_per_image];
     for (uint i = 0; i < num_images * num_tiles_per_image; ++i)
         _tiles[i] = NULL;
     _countIdsAdded = 0;
     _countTilesAdded = 0;
-    _loadingCanceled = false;
+    _countImagesDecoded = 0;
+    _loadingCanceled.storeRelease(0);
+    _loadingStarted = false;
     _loadingSuccessful = false;
+    _thumbnailCache = NULL;
+    _imageCache = NULL;
+    _imageIndex = NULL;
+    _packedDeck = NULL;
+    _statistics = NULL;
+    _clock.start();
+    _tilesize = 0;
+    _maxZoom = 1.0;
+    _numQueued = 0;
+    _numWorkers = 0;
+    _useCounter = 0;
+    _memoryBudget = 0;
+    _memoryUsage = 0;
+    _bytesDelivered = 0;
+    _countDelivered = 0;
+    _disposed = false;
+    _decoderPool = QThreadPool::globalInstance();
 }
 
 TileImageHandler::~TileImageHandler()
 {
+    // The decoder tasks post their results to this object, so it must only be deleted
+    // if none of them is running anymore (see disposeWhenIdle).
     //just delete the refence to the tiles, not the tiles themselves:
     delete[] _tiles; 
-    // TileImageHandler owns the images, so delete all:
-    for (uint i = 0; i < _numImages; ++i)
-        delete _images[i];
+    // the tiles keep their own (shared) copies of the images, so all can be deleted:
     delete[] _images; 
+    delete[] _queuedPriorities;
+    delete[] _requestedTileSizes;
+    delete[] _queuedAt;
+    delete[] _imageDecoded;
+    delete[] _borderColors;
+    delete[] _pinCounts;
+    delete[] _lastUsed;
+    delete[] _evicted;
+    delete[] _released;
     _fnames.clear();
     _id_to_index.clear();
 }
@@ -304,14 +207,167 @@ void TileImageHandler::addTile(const uint id, const QString& filename, Tile* til
 
 void TileImageHandler::cancelLoading()
 {
-    _loadingCanceled = true;
+    _loadingCanceled.storeRelease(1);
+}
+
+void TileImageHandler::setMemoryBudget(const qint64 bytes)
+{
+    QMutexLocker locker(&_queueMutex);
+    _memoryBudget = bytes;
+}
+
+qint64 TileImageHandler::memoryUsage() const
+{
+    QMutexLocker locker(&_queueMutex);
+    return _memoryUsage;
+}
+
+void TileImageHandler::setTileSize(const int tilesize, const double max_zoom)
+{
+    QMutexLocker locker(&_queueMutex);
+    _tilesize = tilesize;
+    _maxZoom = max_zoom;
+    if (!_loadingStarted)
+        return;
+    // Decode again all images that would be up-scaled noticeably on the bigger tiles. Small
+    // changes are ignored, otherwise dragging the window border would decode them over and over.
+    // (Evicted images will be decoded at the new size when they are needed again.)
+    for (uint i = 0; i < _numImages; ++i)
+        if (!_released[i] && !_evicted[i] && _tilesize > 1.25 * _requestedTileSizes[i])
+            queueImage(i, PRIORITY_BACKGROUND);
+    startWorkers();
+}
+
+void TileImageHandler::prioritize(const uint id, const int priority)
+{
+    QMutexLocker locker(&_queueMutex);
+    if (!_id_to_index.contains(id))
+        return;
+    uint index = _id_to_index.value(id);
+    if (_released[index])
+        return;
+    _lastUsed[index] = ++_useCounter;
+    if (priority >= PRIORITY_REVEALED)
+        // don't evict the image while the tile is face up:
+        _pinCounts[index]++;
+    if (_evicted[index]) {
+        // the image is needed again:
+        _evicted[index] = false;
+        queueImage(index, priority);
+    }
+    // only images still waiting in the queue can be moved forward:
+    else if (_queuedPriorities[index] >= 0 && _queuedPriorities[index] < priority)
+        _queuedPriorities[index] = priority;
+    // the workers might have stopped because of the memory budget:
+    startWorkers();
+}
+
+void TileImageHandler::unpin(const uint id)
+{
+    QMutexLocker locker(&_queueMutex);
+    if (!_id_to_index.contains(id))
+        return;
+    uint index = _id_to_index.value(id);
+    if (_pinCounts[index] > 0)
+        _pinCounts[index]--;
+}
+
+void TileImageHandler::releaseImage(const uint id)
+{
+    _queueMutex.lock();
+    if (!_id_to_index.contains(id)) {
+        _queueMutex.unlock();
+        return;
+    }
+    uint index = _id_to_index.value(id);
+    _released[index] = true;
+    _evicted[index] = false;
+    _pinCounts[index] = 0;
+    if (_queuedPriorities[index] >= 0) {
+        _queuedPriorities[index] = -1;
+        _numQueued--;
+    }
+    _memoryUsage -= image_bytes(_images[index]);
+    _images[index] = ImagePyramid();
+    // the freed memory can be used for images not loaded yet:
+    startWorkers();
+    qint64 usage = _memoryUsage;
+    _queueMutex.unlock();
+    
+    // the removed tiles hold copies, too:
+    sendToTiles(index, ImagePyramid());
+    emit memoryUsageChanged(usage);
+}
+
+void TileImageHandler::requestDecode(const uint index)
+{
+    QMutexLocker locker(&_queueMutex);
+    queueImage(index, PRIORITY_BACKGROUND);
+    startWorkers();
+}
+
+void TileImageHandler::queueImage(const uint index, const int priority)
+{
+    _requestedTileSizes[index] = _tilesize;
+    if (_queuedPriorities[index] < 0) {
+        _queuedAt[index] = _clock.nsecsElapsed();
+        _queuedPriorities[index] = priority;
+        _numQueued++;
+    }
+    else if (_queuedPriorities[index] < priority)
+        _queuedPriorities[index] = priority;
+}
+
+void TileImageHandler::startWorkers()
+{
+    // the pool would queue additional workers, but they would have nothing to do:
+    while (_numWorkers < _numQueued && _numWorkers < _decoderPool->maxThreadCount()) {
+        _numWorkers++;
+        _decoderPool->start(new ImageDecodeWorker(this));
+    }
+}
+
+bool TileImageHandler::takeNextImage(uint& index, QString& filename, int& tilesize, double& max_zoom)
+{
+    QMutexLocker locker(&_queueMutex);
+    int best = -1;
+    if (_numQueued > 0 && !isLoadingCanceled()) {
+        // The queue is short (one entry per image pair) and priorities change all the time,
+        // so a linear search is fast enough and simpler than keeping a heap up to date:
+        for (uint i = 0; i < _numImages; ++i)
+            if (_queuedPriorities[i] >= 0 && (best < 0 || _queuedPriorities[i] > _queuedPriorities[best]))
+                best = i;
+        // Images needed right now are always loaded. Others only if one more image of average 
+        // size still fits in the memory budget, otherwise they wait until they are needed:
+        if (best >= 0 && _queuedPriorities[best] == PRIORITY_BACKGROUND && _memoryBudget > 0 && _countDelivered > 0 &&
+            _memoryUsage + _bytesDelivered / _countDelivered > _memoryBudget)
+            best = -1;
+    }
+    if (best < 0) {
+        // Done. This is decided while the mutex is locked, so requestDecode and prioritize 
+        // will start a new worker if they queue an image afterwards:
+        _numWorkers--;
+        if (_numWorkers == 0)
+            // (after this, the worker does not touch the handler anymore)
+            QMetaObject::invokeMethod(this, "workersFinished", Qt::QueuedConnection);
+        return false;
+    }
+    index = best;
+    if (_statistics)
+        _statistics->addTime(LoaderStatistics::STAGE_QUEUE_WAIT, _clock.nsecsElapsed() - _queuedAt[index]);
+    _queuedPriorities[index] = -1;
+    _numQueued--;
+    filename = _fnames[index];
+    tilesize = _requestedTileSizes[index];
+    max_zoom = _maxZoom;
+    return true;
 }
 
 
 void TileImageHandler::startLoading()
 {
-    if (_loadingSuccessful){
-        printf("Warning: startLoading() called although all images have been "
+    if (_loadingStarted){
+        printf("Warning: startLoading() called although the images are "
                "loaded already. Ignoring function call.\n");
         return;
     }
@@ -323,58 +379,241 @@ void TileImageHandler::startLoading()
         return;
     }
 
-    for (uint i = 0; i < _numImages; ++i) {
-        // this takes some time:
-        if (!_images[i])
-            _images[i] = new QImage(_fnames[i]);
-        if (_loadingCanceled) {
-            break;
-        }
-        if (_images[i]->isNull())
-            printf("WARNING: Failed to open file %s\n", _fnames[i].toStdString().c_str());
-        
-        //QColor bordercolor = get_most_prominent_hue(iQColormage);
-        //QColor bordercolor = get_average_color(image);
-        //QColor bordercolor = get_most_prominent_color_slow(image);
-        QColor bordercolor = get_most_prominent_color(*_images[i]);
-        
-        // after one image has been loaded, distribute this image to all tiles with the same id:
-        for (uint j = 0; j < _numTilesPerImage; ++j)
-            // Calling Tile::setImage method directly does not work, since it will be executed in the current thread:
-            //tiles[i * numTilesPerImage + j]->setImage(images[i], bordercolor);
-            // setImage calls update() of the Tile, this should be executed in the GUI thread. To achieve this,
-            // connect with a QueuedConnection, emit a signal and disconnect again:
-            connect(this, SIGNAL(sendImage(QImage*,QColor)), _tiles[i * _numTilesPerImage + j], SLOT(setImage(QImage*,QColor)),
-                    Qt::QueuedConnection
-            );
-        // note: the Tile objects do not take ownership of the images
-        
-        // send the loaded image and the color to the tiles:
-        emit sendImage(_images[i], bordercolor);
-        // and disconnect the signal again:
+    // Queue all images. The workers decode them in this order, unless some are prioritized:
+    _loadingStarted = true;
+    _countImagesDecoded = 0;
+    for (uint i = 0; i < _numImages; ++i)
+        requestDecode(i);
+}
+
+void TileImageHandler::sendToTiles(const uint index, const ImagePyramid& levels)
+{
+    if (_loadingCanceled.loadAcquire())
+        return;
+    // Tile::setImage calls update(), so it must be executed in the GUI thread. Instead of a queued
+    // signal for each tile, the images are collected in a queue, which the GUI thread empties
+    // in batches (see deliverImages):
+    Delivery delivery;
+    delivery.index = index;
+    delivery.levels = levels;
+    delivery.bordercolor = _borderColors[index];
+    delivery.decoded_at = _clock.nsecsElapsed();
+    _deliveries.push(delivery);
+    if (_deliveryPending.testAndSetOrdered(0, 1))
+        emit imagesReady();
+}
+
+bool TileImageHandler::deliverImages(const int max_images)
+{
+    // images queued from now on need a new signal:
+    _deliveryPending.fetchAndStoreOrdered(0);
+    Delivery delivery;
+    for (int i = 0; i < max_images && _deliveries.pop(delivery); ++i) {
+        // distribute this image to all tiles with the same id:
         for (uint j = 0; j < _numTilesPerImage; ++j)
-            disconnect(this, SIGNAL(sendImage(QImage*,QColor)), _tiles[i * _numTilesPerImage + j], SLOT(setImage(QImage*,QColor)));
+            _tiles[delivery.index * _numTilesPerImage + j]->setImage(delivery.levels, delivery.bordercolor);
+        if (_statistics && !delivery.levels.isEmpty())
+            _statistics->addTime(LoaderStatistics::STAGE_DELIVERY, _clock.nsecsElapsed() - delivery.decoded_at);
     }
+    return !_deliveries.isEmpty();
+}
+
+void TileImageHandler::imageDecoded(uint index, ImagePyramid levels, QColor bordercolor, int tilesize)
+{
+    if (_loadingCanceled.loadAcquire())
+        // the tiles might not exist anymore
+        return;
     
-    _loadingSuccessful = !_loadingCanceled;
-    if (_loadingSuccessful) {
-        // clear file names and refences to tiles: we don't need them anymore
+    _queueMutex.lock();
+    if (_released[index] || _evicted[index] || tilesize < _requestedTileSizes[index]) {
+        // the pair has been removed from the board or the image evicted meanwhile, or this is an outdated result 
+        // and a bigger version of this image is being decoded already:
+        _queueMutex.unlock();
+        return;
+    }
+    // The image is implicitly shared with the tiles, so the previous version 
+    // will be freed as soon as all tiles got the new one:
+    _memoryUsage += image_bytes(levels) - image_bytes(_images[index]);
+    _images[index] = levels;
+    _borderColors[index] = bordercolor;
+    _lastUsed[index] = ++_useCounter;
+    _bytesDelivered += image_bytes(levels);
+    _countDelivered++;
+    _queueMutex.unlock();
+    
+    sendToTiles(index, levels);
+    evictImages();
+    emit memoryUsageChanged(memoryUsage());
+    
+    if (_imageDecoded[index])
+        // this was a re-decode for bigger tiles or an evicted image
+        return;
+    _imageDecoded[index] = true;
+    _countImagesDecoded++;
+    
+    if (_countImagesDecoded < _numImages || _loadingSuccessful)
+        // wait for the remaining decoder tasks:
+        return;
+    
+    // finished loading all files. The file names and references to the tiles are kept,
+    // because the images might need to be decoded again for bigger tiles.
+    _loadingSuccessful = true;
+    emit finishedLoading(_loadingSuccessful);
+}
 
-        // just delete the refence to the tiles, not the tiles themselves:
-        delete[] _tiles;
-        _tiles = NULL;
+void TileImageHandler::placeholderDecoded(uint index, ImagePyramid levels, QColor bordercolor)
+{
+    if (_loadingCanceled.loadAcquire())
+        // the tiles might not exist anymore
+        return;
+    
+    _queueMutex.lock();
+    if (_released[index] || !_images[index].isEmpty()) {
+        // the tiles are gone or already show a better version
+        _queueMutex.unlock();
+        return;
+    }
+    // The placeholder is not kept in _images and not counted in the memory usage, it is tiny
+    // and replaced as soon as imageDecoded is called for this image:
+    _borderColors[index] = bordercolor;
+    _queueMutex.unlock();
+    
+    sendToTiles(index, levels);
+}
 
-        _fnames.clear();
-        _id_to_index.clear();
+void TileImageHandler::workersFinished()
+{
+    _queueMutex.lock();
+    // (a new worker might have been started meanwhile)
+    bool idle = _numWorkers == 0;
+    bool paused = idle && _numQueued > 0;
+    _queueMutex.unlock();
+    if (idle && _disposed)
+        deleteLater();
+    else if (paused)
+        backgroundLoadingPaused();
+}
 
-        // TileImageHandler owns the QImages, which are still used by the tiles.
-        // They will be deleted with ~TileImageHandler.
+void TileImageHandler::disposeWhenIdle()
+{
+    QMutexLocker locker(&_queueMutex);
+    _disposed = true;
+    if (_numWorkers == 0)
+        deleteLater();
+    // otherwise, workersFinished deletes the handler
+}
+
+void TileImageHandler::backgroundLoadingPaused()
+{
+    // The remaining images don't fit in the memory budget and will be decoded when needed.
+    // Nevertheless, the game is ready now:
+    if (!_loadingSuccessful && !_loadingCanceled.loadAcquire()) {
+        _loadingSuccessful = true;
+        emit finishedLoading(_loadingSuccessful);
     }
+}
 
-    // finished loading all files:
-    emit finishedLoading(_loadingSuccessful);
-    
-    
+void TileImageHandler::evictImages()
+{
+    forever {
+        _queueMutex.lock();
+        if (_memoryBudget <= 0 || _memoryUsage <= _memoryBudget) {
+            _queueMutex.unlock();
+            return;
+        }
+        // find the least recently used image whose tiles are all face down:
+        int victim = -1;
+        for (uint i = 0; i < _numImages; ++i)
+            if (!_images[i].isEmpty() && _pinCounts[i] == 0 && (victim < 0 || _lastUsed[i] < _lastUsed[victim]))
+                victim = i;
+        if (victim < 0) {
+            // all images in memory are needed
+            _queueMutex.unlock();
+            return;
+        }
+        _memoryUsage -= image_bytes(_images[victim]);
+        _images[victim] = ImagePyramid();
+        // it will be decoded again as soon as it is prioritized, not before:
+        _evicted[victim] = true;
+        if (_queuedPriorities[victim] >= 0) {
+            _queuedPriorities[victim] = -1;
+            _numQueued--;
+        }
+        _queueMutex.unlock();
+        
+        sendToTiles(victim, ImagePyramid());
+    }
+}
+
+ImageLoader::ImageLoader(QObject* parent) : QObject(parent)
+{
+    _decoderPool.setMaxThreadCount(QThread::idealThreadCount());
+    // keep the decoder threads from one game to the next:
+    _decoderPool.setExpiryTimeout(-1);
+    _thread.start();
+}
+
+ImageLoader::~ImageLoader()
+{
+    // Stop the thread first, so no handler deletes itself while it is accessed here:
+    _thread.quit();
+    _thread.wait();
+    cancelPrefetch();
+    for (int i = 0; i < _handlers.count(); ++i)
+        if (_handlers.at(i))
+            _handlers.at(i)->cancelLoading();
+    // the canceled decoders stop quickly:
+    _decoderPool.waitForDone();
+    // the remaining handlers (not disposed of or not deleted yet):
+    for (int i = 0; i < _handlers.count(); ++i)
+        delete _handlers.at(i);
+}
+
+void ImageLoader::setMaxWorkers(const int count)
+{
+    _decoderPool.setMaxThreadCount(count > 0 ? count : QThread::idealThreadCount());
+}
+
+void ImageLoader::start(TileImageHandler* handler)
+{
+    // forget the handlers which have been deleted:
+    for (int i = _handlers.count() - 1; i >= 0; --i)
+        if (!_handlers.at(i))
+            _handlers.removeAt(i);
+    _handlers.append(handler);
+    handler->setDecoderPool(&_decoderPool);
+    handler->setImageCache(&_imageCache);
+    handler->setStatistics(&_statistics);
+    handler->moveToThread(&_thread);
+    QMetaObject::invokeMethod(handler, "startLoading", Qt::QueuedConnection);
+}
+
+void ImageLoader::prefetch(const QStringList& filenames, const int tilesize, const double max_zoom, 
+                           ThumbnailCache* thumbnail_cache, const ImageIndex* image_index, 
+                           const PackedDeck* packed_deck)
+{
+    // the images of a previous prefetch are not needed anymore:
+    cancelPrefetch();
+    if (_imageCache.maxBytes() <= 0)
+        // nowhere to keep the images
+        return;
+    _prefetchCanceled = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+    // Only one thread is used, and it is only started when no decoder of 
+    // the current game is waiting, because those have a higher priority:
+    _decoderPool.start(new ImagePrefetchTask(filenames, tilesize, max_zoom, &_imageCache, thumbnail_cache,
+                                             image_index, packed_deck, _prefetchCanceled), -1);
+}
+
+void ImageLoader::cancelPrefetch()
+{
+    if (_prefetchCanceled)
+        _prefetchCanceled->storeRelease(1);
+}
+
+void ImageLoader::dispose(TileImageHandler* handler)
+{
+    handler->cancelLoading();
+    QMetaObject::invokeMethod(handler, "disposeWhenIdle", Qt::QueuedConnection);
 }
 
 //#include "tileimagehandler.moc"
@@ -26,38 +26,268 @@
 #define TILEIMAGEHANDLER_H
 
 #include <QObject>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QPointer>
+#include <QSharedPointer>
 #include "tile.h"
+#include "imagedecoder.h"
+#include "imagecache.h"
+#include "spscqueue.h"
 
-struct pixeldata_t { int r, g, b, weight, count; };
+class TileImageHandler;
 
-// This class will be run in a separate thread. It loads images from the hdd in the background 
-// without blocking the GUI and distributes the loaded QImages to the tiles.
+// Priorities of the images waiting to be decoded (see TileImageHandler::prioritize):
+enum IMAGE_PRIORITY
+{
+    PRIORITY_BACKGROUND = 0,
+    PRIORITY_HOVERED = 1, // the mouse is over one of the image's tiles
+    PRIORITY_REVEALED = 2 // one of the image's tiles is being turned over
+};
+
+// Decodes images and determines their border colors. Several of these workers run concurrently
+// in the decoder pool of a TileImageHandler. Each one takes the image with the highest priority 
+// from the handler's queue, until the queue is empty. The handler then distributes the results to 
+// the tiles. The images are decoded just big enough for the handler's current tile size.
+class ImageDecodeWorker : public QRunnable
+{
+public:
+    ImageDecodeWorker(TileImageHandler *handler);
+    virtual void run();
+    
+private:
+    void decode(const uint index, const QString &filename, const int tilesize, const double max_zoom);
+    
+    TileImageHandler *_handler;
+};
+
+// Decodes the images of a future game into an ImageCache, one after another, until canceled.
+class ImagePrefetchTask : public QRunnable
+{
+public:
+    ImagePrefetchTask(const QStringList &filenames, const int tilesize, const double max_zoom, 
+                      ImageCache *image_cache, ThumbnailCache *thumbnail_cache, 
+                      const ImageIndex *image_index, const PackedDeck *packed_deck, 
+                      QSharedPointer<QAtomicInt> canceled);
+    virtual void run();
+    
+private:
+    const QStringList _filenames;
+    const int _tilesize;
+    const double _maxZoom;
+    ImageCache *_imageCache;
+    ThumbnailCache *_thumbnailCache;
+    const ImageIndex *_imageIndex;
+    const PackedDeck *_packedDeck;
+    // shared with the ImageLoader, which might forget it before the task has finished:
+    QSharedPointer<QAtomicInt> _canceled;
+};
+
+// This class will be run in a separate thread (see ImageLoader). It loads images from the hdd in 
+// the background without blocking the GUI and distributes the loaded QImages to the tiles. The 
+// images themselves are decoded in parallel by a pool of worker threads (see setDecoderPool),
+// directly at the resolution needed for the current tile size (see setTileSize).
 class TileImageHandler : public QObject
 {
     Q_OBJECT
     
+    friend class ImageDecodeWorker;
+    
 public:
     TileImageHandler(const uint num_images, const uint num_tiles_per_image, QObject* parent = 0);
     ~TileImageHandler();
     
     void addTile(const uint id, const QString &filename, Tile *tile);
+    // Can be called from any thread. The running decoders stop soon. The handler only touches the
+    // tiles in deliverImages, so they can be deleted as soon as that is not called anymore.
     void cancelLoading();
+    bool isLoadingCanceled() const { return _loadingCanceled.loadAcquire() != 0; };
+    // Set by cancelLoading, checked by the decoders while they work on an image:
+    const QAtomicInt *cancelToken() const { return &_loadingCanceled; };
+    
+    // Sets the pool in which the images are decoded. Not more images are decoded simultaneously
+    // than the pool has threads. The default is the global thread pool. The handler does not
+    // take ownership. Should be called before startLoading.
+    void setDecoderPool(QThreadPool *pool) { _decoderPool = pool; };
+    
+    // If a cache is set, images are taken from there if possible, and newly decoded images are
+    // added to it. The handler does not take ownership. Should be called before startLoading.
+    void setThumbnailCache(ThumbnailCache *cache) { _thumbnailCache = cache; };
+    ThumbnailCache *thumbnailCache() const { return _thumbnailCache; };
+    // The same for the cache in memory, which is checked before the thumbnail cache:
+    void setImageCache(ImageCache *cache) { _imageCache = cache; };
+    ImageCache *imageCache() const { return _imageCache; };
+    // If an index is set, the border colors and image sizes are taken from there for all 
+    // indexed images. The handler does not take ownership. Should be called before startLoading.
+    void setImageIndex(const ImageIndex *index) { _imageIndex = index; };
+    const ImageIndex *imageIndex() const { return _imageIndex; };
+    // If a deck is set, the images packed into it are taken from there, before any cache is checked.
+    // The handler does not take ownership. Should be called before startLoading.
+    void setPackedDeck(const PackedDeck *deck) { _packedDeck = deck; };
+    const PackedDeck *packedDeck() const { return _packedDeck; };
+    // If set, the time spent on each image is added to statistics. The handler does not take 
+    // ownership. Should be called before startLoading.
+    void setStatistics(LoaderStatistics *statistics) { _statistics = statistics; };
+    LoaderStatistics *statistics() const { return _statistics; };
+    
+    // Moves the image of the tiles with id forward in the queue of images waiting to be decoded,
+    // if it has a lower priority than priority (see IMAGE_PRIORITY). Images with the same
+    // priority are decoded in the order the tiles were added. Can be called from any thread.
+    // If the image has been evicted, it is queued again. Tiles shown face up must be prioritized
+    // with PRIORITY_REVEALED, which keeps their image from being evicted until unpin is called.
+    void prioritize(const uint id, const int priority);
+    
+    // Limits the memory used by the decoded images to about bytes (0: no limit). Images are 
+    // decoded in the background only as long as they fit in the budget, the others are decoded
+    // when they are prioritized. If the budget is exceeded, the least recently used images of 
+    // tiles shown face down are evicted. Can be called from any thread.
+    void setMemoryBudget(const qint64 bytes);
+    qint64 memoryUsage() const;
+    
+    // Called in the GUI thread (e.g. once per frame after imagesReady): passes not more than 
+    // max_images of the images waiting for delivery to their tiles. Returns true if there are more.
+    bool deliverImages(const int max_images);
     
 public slots:
     void startLoading();
+    // Images are decoded just big enough to be shown on tiles of size tilesize zoomed by max_zoom. 
+    // If the tiles grow noticeably after the images have been loaded, they are decoded again.
+    // Should be called before startLoading.
+    void setTileSize(const int tilesize, const double max_zoom);
+    // The tiles with id are shown face down again, their image may be evicted:
+    void unpin(const uint id);
+    // The tiles with id have been removed from the game, their image is freed immediately:
+    void releaseImage(const uint id);
+    
+private slots:
+    // Invoked in the handler's thread by ImageDecodeWorker after image index has been decoded for
+    // tiles of size tilesize (levels is empty if loading was canceled or the file is broken):
+    void imageDecoded(uint index, ImagePyramid levels, QColor bordercolor, int tilesize);
+    // Invoked in the handler's thread by ImageDecodeWorker before it decodes image index: levels is
+    // a small version (e.g. the EXIF thumbnail), shown on the tiles until the image itself arrives.
+    void placeholderDecoded(uint index, ImagePyramid levels, QColor bordercolor);
+    // Invoked when the workers stopped because the remaining images don't fit in the memory budget:
+    void backgroundLoadingPaused();
+    // Invoked by ImageLoader::dispose after cancelLoading: deletes the handler as soon as none 
+    // of its workers is running anymore.
+    void disposeWhenIdle();
+    // Invoked when the last worker has finished:
+    void workersFinished();
     
 signals:
     void finishedLoading(bool success);
-    void sendImage(QImage *img, const QColor bordercolor);
+    void memoryUsageChanged(qint64 bytes);
+    // Emitted when images are waiting for deliverImages. Not emitted again before deliverImages 
+    // has been called:
+    void imagesReady();
     
 private:
+    // Queues image index for decoding at the current tile size:
+    void requestDecode(const uint index);
+    // Same, with priority (raised if the image is queued already). _queueMutex must be locked.
+    void queueImage(const uint index, const int priority);
+    // Starts more workers if there are more queued images than workers. _queueMutex must be locked.
+    void startWorkers();
+    // Called by the workers: returns false if no image is waiting to be decoded (then the worker
+    // must finish), otherwise takes the queued image with the highest priority.
+    bool takeNextImage(uint &index, QString &filename, int &tilesize, double &max_zoom);
+    // Queues levels for delivery to all tiles of image index:
+    void sendToTiles(const uint index, const ImagePyramid &levels);
+    // Evicts least recently used images until the memory usage is within the budget:
+    void evictImages();
+    
     const uint _numImages, _numTilesPerImage;
-    uint _countIdsAdded, _countTilesAdded;
-    bool _loadingCanceled, _loadingSuccessful;
+    uint _countIdsAdded, _countTilesAdded, _countImagesDecoded;
+    bool _loadingStarted, _loadingSuccessful;
+    // set from the GUI thread, read by the workers:
+    QAtomicInt _loadingCanceled;
+    // Images on the way to the tiles, from the handler's thread to the GUI thread:
+    struct Delivery {
+        uint index;
+        ImagePyramid levels;
+        QColor bordercolor;
+        qint64 decoded_at; // by _clock, in ns
+    };
+    SpscQueue<Delivery> _deliveries;
+    QAtomicInt _deliveryPending; // whether imagesReady has been emitted and deliverImages not called since
+    bool _disposed;
+    QThreadPool *_decoderPool;
+    ThumbnailCache *_thumbnailCache;
+    ImageCache *_imageCache;
+    const ImageIndex *_imageIndex;
+    const PackedDeck *_packedDeck;
+    LoaderStatistics *_statistics;
+    // for the queue and delivery times:
+    QElapsedTimer _clock;
+    int _tilesize;
+    double _maxZoom;
     QHash<uint, uint> _id_to_index; // map from id number to index of local arrays
     QStringList _fnames; // list of filenames (length: num_images)
-    QImage **_images; // array of pointers to loaded images (length: num_images)
+    ImagePyramid *_images; // array of loaded images, shared with the tiles (length: num_images)
+    // The queue of images waiting to be decoded, shared with the workers:
+    mutable QMutex _queueMutex;
+    int *_queuedPriorities; // priority of each image in the queue, -1 if not queued (length: num_images)
+    int *_requestedTileSizes; // tile size for which each image was last queued (length: num_images)
+    qint64 *_queuedAt; // time (by _clock, in ns) when each image was queued (length: num_images)
+    int _numQueued, _numWorkers;
+    bool *_imageDecoded; // whether an image has been delivered at least once (length: num_images)
+    QColor *_borderColors; // border color of each image, kept when it is evicted (length: num_images)
+    // Memory budget, also protected by _queueMutex:
+    qint64 _memoryBudget, _memoryUsage;
+    qint64 _bytesDelivered; // sum of the sizes of all delivered images, for the average size
+    uint _countDelivered;
+    int *_pinCounts; // number of tiles shown face up for each image (length: num_images)
+    quint64 *_lastUsed; // value of _useCounter when an image was used the last time (length: num_images)
+    quint64 _useCounter;
+    bool *_evicted; // whether an image has been evicted and must be decoded when needed (length: num_images)
+    bool *_released; // whether the tiles of an image have been removed (length: num_images)
     Tile** _tiles; // array of pointers to Tile objects (length: num_tiles_per_imagehe*num_images)
 };
 
+// The service which runs the TileImageHandlers of all games. It has a thread for the handlers and 
+// a pool of decoder threads, which are kept from one game to the next. The handler of a finished 
+// game is disposed of in the background, so a new game neither waits for it to stop nor for
+// new threads to start.
+class ImageLoader : public QObject
+{
+    Q_OBJECT
+    
+public:
+    ImageLoader(QObject *parent = 0);
+    // Stops all handlers and waits until their decoders have finished.
+    ~ImageLoader();
+    
+    // Sets the maximum number of images that are decoded simultaneously (0: number of CPU cores):
+    void setMaxWorkers(const int count);
+    // The decoded images are kept in this cache for the next games (see ImageCache):
+    ImageCache *imageCache() { return &_imageCache; };
+    // The time spent loading the images of all games (see LoaderStatistics):
+    LoaderStatistics *statistics() { return &_statistics; };
+    
+    // Moves handler to the loader thread and starts loading. The loader takes ownership.
+    void start(TileImageHandler *handler);
+    // Cancels loading of handler, which is deleted in the background as soon as its decoders have
+    // stopped. The tiles of handler can be deleted right after this returns.
+    void dispose(TileImageHandler *handler);
+    
+    // Decodes filenames into the image cache in the background, with a lower priority than the
+    // decoders of all handlers, so they are ready when the next game starts. A previous prefetch
+    // is canceled. The caches, the index and the deck are used as in decode_image_levels.
+    void prefetch(const QStringList &filenames, const int tilesize, const double max_zoom, 
+                  ThumbnailCache *thumbnail_cache, const ImageIndex *image_index, const PackedDeck *packed_deck);
+    void cancelPrefetch();
+    
+private:
+    QThread _thread;
+    QThreadPool _decoderPool;
+    ImageCache _imageCache;
+    LoaderStatistics _statistics;
+    QSharedPointer<QAtomicInt> _prefetchCanceled;
+    // handlers started and not deleted yet:
+    QList<QPointer<TileImageHandler> > _handlers;
+};
+
 #endif // TILEIMAGEHANDLER_H